@@ -0,0 +1,85 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "ChatHistory.h"
+#include <algorithm>
+
+// Change the capacity in place, keeping the newest turns
+void ChatHistory::setCapacity(size_t capacity)
+{
+	if (capacity == 0)
+	{
+		capacity = 1;
+	}
+	if (capacity == _capacity)
+	{
+		return;
+	}
+
+	// Shrink: drop the oldest turns
+	linearize();
+	if (_turns.size() > capacity)
+	{
+		size_t dropCount = _turns.size() - capacity;
+		for (size_t i = 0; i < dropCount; i++)
+		{
+			_bytes -= _turns[i].question.size() + _turns[i].answer.size();
+		}
+		_turns.erase(_turns.begin(), _turns.begin() + dropCount);
+		_turns.shrink_to_fit();
+		_dropped += dropCount;
+	}
+	_capacity = capacity;
+}
+
+// Add a turn, overwriting the oldest one when full
+void ChatHistory::add(std::string question, std::string answer)
+{
+	_bytes += question.size() + answer.size();
+	if (_turns.size() < _capacity)
+	{
+		linearize();
+		_turns.push_back({ std::move(question), std::move(answer) });
+		return;
+	}
+
+	// Full: reuse the slot of the oldest turn
+	ChatTurn& oldest = _turns[_head];
+	_bytes -= oldest.question.size() + oldest.answer.size();
+	oldest.question = std::move(question);
+	oldest.answer = std::move(answer);
+	_head = (_head + 1) % _turns.size();
+	_dropped++;
+}
+
+void ChatHistory::clear()
+{
+	_dropped += _turns.size();
+	_turns.clear();
+	_head = 0;
+	_bytes = 0;
+}
+
+// Move the oldest turn to index 0
+void ChatHistory::linearize()
+{
+	if (_head != 0)
+	{
+		std::rotate(_turns.begin(), _turns.begin() + _head, _turns.end());
+		_head = 0;
+	}
+}
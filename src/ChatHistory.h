@@ -0,0 +1,68 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#ifndef PLUGINNPPOPENAI_CHATHISTORY_H
+#define PLUGINNPPOPENAI_CHATHISTORY_H
+
+#include <string>
+#include <vector>
+
+// One question + answer, stored as UTF-8 (as sent to / received from Ollama)
+struct ChatTurn
+{
+	std::string question;
+	std::string answer;
+};
+
+// Fixed-capacity ring buffer of the last chat turns (`chatSetting_chatLimit`)
+// Not thread-safe: only used on the UI thread
+class ChatHistory
+{
+public:
+	explicit ChatHistory(size_t capacity = 10) : _capacity(capacity > 0 ? capacity : 1) {};
+
+	// Change the capacity in place, keeping the newest turns
+	void setCapacity(size_t capacity);
+	size_t capacity() const { return _capacity; };
+
+	// Add a turn, overwriting the oldest one when full
+	void add(std::string question, std::string answer);
+	void clear();
+
+	// Stored turns, `at(0)` is the oldest
+	size_t size() const { return _turns.size(); };
+	const ChatTurn& at(size_t index) const { return _turns[(_head + index) % _turns.size()]; };
+
+	// Number of turns ever added / dropped, usable as stable turn numbers (`at(turnNumber - firstTurnNumber())`)
+	unsigned long long firstTurnNumber() const { return _dropped; };
+	unsigned long long endTurnNumber() const { return _dropped + _turns.size(); };
+
+	// Text bytes stored
+	size_t bytes() const { return _bytes; };
+
+protected:
+	void linearize();
+
+	std::vector<ChatTurn> _turns; // Grows up to `_capacity`, then `_head` wraps around
+	size_t _capacity;
+	size_t _head = 0;             // Index of the oldest turn
+	size_t _bytes = 0;
+	unsigned long long _dropped = 0;
+};
+
+
+#endif // PLUGINNPPOPENAI_CHATHISTORY_H
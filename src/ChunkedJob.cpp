@@ -0,0 +1,329 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "ChunkedJob.h"
+
+// Move back to the first byte of a UTF-8 sequence
+static size_t alignToUTF8(const std::string& text, size_t pos, size_t minPos)
+{
+	while (pos > minPos && pos < text.size() && ((unsigned char)text[pos] & 0xC0) == 0x80)
+	{
+		pos--;
+	}
+	return pos;
+}
+
+// Move forward to the end of the UTF-8 sequence starting at `pos`
+static size_t nextUTF8(const std::string& text, size_t pos)
+{
+	pos++;
+	while (pos < text.size() && ((unsigned char)text[pos] & 0xC0) == 0x80)
+	{
+		pos++;
+	}
+	return pos;
+}
+
+// Split a UTF-8 text into chunks of max. `chunkSize` bytes, preferably at line ends
+std::vector<TextChunk> splitTextIntoChunks(const std::string& text, size_t chunkSize, size_t overlap)
+{
+	std::vector<TextChunk> chunks;
+	if (overlap >= chunkSize / 2)
+	{
+		overlap = (chunkSize >= 2) ? chunkSize / 2 - 1 : 0; // Every chunk must bring new text
+	}
+
+	size_t pos = 0;
+	while (pos < text.size())
+	{
+		TextChunk chunk;
+
+		// Start with the overlap, from the beginning of a line if there's one
+		chunk.begin = pos;
+		if (pos > 0 && overlap > 0)
+		{
+			size_t overlapBegin = pos - overlap;
+			size_t lineBegin = text.find('\n', overlapBegin);
+			chunk.begin = (lineBegin != std::string::npos && lineBegin + 1 < pos)
+				? lineBegin + 1
+				: alignToUTF8(text, overlapBegin, 0);
+		}
+
+		// End at the last line end in the second half of the chunk, or between two characters.
+		// At least one whole character of new text, even if it doesn't fit (tiny `chunkSize`): the loop always advances.
+		size_t newTextSize = (chunkSize > pos - chunk.begin) ? chunkSize - (pos - chunk.begin) : 0;
+		chunk.end = (text.size() - pos > newTextSize) ? pos + newTextSize : text.size();
+		if (chunk.end < text.size())
+		{
+			size_t lineEnd = (chunk.end > pos) ? text.rfind('\n', chunk.end - 1) : std::string::npos;
+			if (lineEnd != std::string::npos && lineEnd >= pos + newTextSize / 2)
+			{
+				chunk.end = lineEnd + 1;
+			}
+			else
+			{
+				chunk.end = alignToUTF8(text, chunk.end, pos);
+			}
+			if (chunk.end <= pos)
+			{
+				chunk.end = nextUTF8(text, pos);
+			}
+		}
+
+		chunks.push_back(chunk);
+		pos = chunk.end;
+	}
+	return chunks;
+}
+
+ChunkedJob::ChunkedJob(std::vector<std::string> prompts, size_t maxParallel, std::string reducePrompt, Backend backend, BackendCancel backendCancel, FinishHandler onFinish)
+	: _prompts(std::move(prompts))
+	, _answers(_prompts.size())
+	, _maxParallel(maxParallel > 0 ? maxParallel : 1)
+	, _reducePrompt(std::move(reducePrompt))
+	, _backend(backend)
+	, _backendCancel(backendCancel)
+	, _onFinish(onFinish)
+{
+}
+
+void ChunkedJob::start()
+{
+	if (_prompts.empty())
+	{
+		ChunkedJobResult result;
+		result.isOK = true;
+		finish(result);
+		return;
+	}
+	sendNextChunks();
+}
+
+// Stop sending chunks and cancel the running ones, `onFinish` will be called when they're finished
+void ChunkedJob::cancel()
+{
+	std::vector<BackendRequestId> requestIds;
+	bool isIdle = false;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_isCancelled || _isFinished)
+		{
+			return;
+		}
+		_isCancelled = true;
+		for (auto& runningRequest : _runningRequests)
+		{
+			if (runningRequest.second != 0)
+			{
+				requestIds.push_back(runningRequest.second);
+			}
+		}
+		isIdle = (_runningCount == 0);
+	}
+
+	for (BackendRequestId requestId : requestIds)
+	{
+		_backendCancel(requestId);
+	}
+
+	if (isIdle)
+	{
+		ChunkedJobResult result;
+		finish(result);
+	}
+}
+
+size_t ChunkedJob::completedCount() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _completedCount;
+}
+
+// Send chunks until `_maxParallel` are running
+void ChunkedJob::sendNextChunks()
+{
+	std::shared_ptr<ChunkedJob> self = shared_from_this();
+	while (true)
+	{
+		size_t index;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (_isCancelled || _nextIndex >= _prompts.size() || _runningCount >= _maxParallel)
+			{
+				return;
+			}
+			index = _nextIndex++;
+			_runningCount++;
+			_runningRequests[index] = 0; // Sending...
+		}
+
+		// The backend may answer on another thread before returning (or even synchronously)
+		BackendRequestId requestId = _backend(_prompts[index], [self, index](bool isOK, const std::string& text)
+		{
+			self->onChunkAnswer(index, isOK, text);
+		});
+		if (requestId == 0)
+		{
+			onChunkAnswer(index, false, "The request could not be sent");
+			continue;
+		}
+
+		bool isCancelledMeanwhile = false;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			auto runningRequest = _runningRequests.find(index);
+			if (runningRequest != _runningRequests.end())
+			{
+				runningRequest->second = requestId;
+				isCancelledMeanwhile = _isCancelled;
+			}
+		}
+		if (isCancelledMeanwhile)
+		{
+			_backendCancel(requestId);
+		}
+	}
+}
+
+// Store the answer of a chunk, then send the next one / stitch the answers
+void ChunkedJob::onChunkAnswer(size_t index, bool isOK, const std::string& text)
+{
+	ChunkedJobResult result;
+	bool isMapFinished = false;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_runningRequests.erase(index) == 0)
+		{
+			return; // Answered twice
+		}
+		_runningCount--;
+		_completedCount++;
+		_answers[index] = text;
+		if (!isOK)
+		{
+			_failedCount++;
+			if (_errorText.empty())
+			{
+				_errorText = text;
+			}
+		}
+
+		isMapFinished = (_runningCount == 0) && (_isCancelled || _completedCount == _prompts.size());
+		if (isMapFinished)
+		{
+			result.isCancelled = _isCancelled;
+			result.isOK = !_isCancelled && _failedCount == 0;
+			result.errorText = _errorText;
+			result.chunkCount = _prompts.size();
+			result.failedCount = _failedCount;
+			for (size_t i = 0; i < _answers.size(); i++)
+			{
+				if (i > 0)
+				{
+					result.text += "\n\n";
+				}
+				result.text += _answers[i];
+			}
+		}
+	}
+
+	if (!isMapFinished)
+	{
+		sendNextChunks();
+		return;
+	}
+
+	// Reduce pass: combine the answers of the chunks
+	if (result.isOK && !_reducePrompt.empty() && _prompts.size() > 1)
+	{
+		std::shared_ptr<ChunkedJob> self = shared_from_this();
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_runningCount++;
+			_runningRequests[_prompts.size()] = 0;
+		}
+		BackendRequestId requestId = _backend(_reducePrompt + "\n\n" + result.text, [self](bool isOK, const std::string& text)
+		{
+			self->onReduceAnswer(isOK, text);
+		});
+		if (requestId == 0)
+		{
+			onReduceAnswer(false, "The request could not be sent");
+			return;
+		}
+
+		bool isCancelledMeanwhile = false;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			auto runningRequest = _runningRequests.find(_prompts.size());
+			if (runningRequest != _runningRequests.end())
+			{
+				runningRequest->second = requestId;
+				isCancelledMeanwhile = _isCancelled;
+			}
+		}
+		if (isCancelledMeanwhile)
+		{
+			_backendCancel(requestId);
+		}
+		return;
+	}
+
+	finish(result);
+}
+
+// Answer of the reduce pass
+void ChunkedJob::onReduceAnswer(bool isOK, const std::string& text)
+{
+	ChunkedJobResult result;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_runningRequests.erase(_prompts.size()) == 0)
+		{
+			return;
+		}
+		_runningCount--;
+		result.isCancelled = _isCancelled;
+		result.isOK = isOK && !_isCancelled;
+		result.chunkCount = _prompts.size();
+		if (isOK)
+		{
+			result.text = text;
+		}
+		else
+		{
+			result.errorText = text;
+		}
+	}
+	finish(result);
+}
+
+// Call `onFinish` once
+void ChunkedJob::finish(ChunkedJobResult& result)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_isFinished)
+		{
+			return;
+		}
+		_isFinished = true;
+		result.isCancelled = result.isCancelled || _isCancelled;
+		result.chunkCount = _prompts.size();
+	}
+	_onFinish(result);
+}
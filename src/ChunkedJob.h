@@ -0,0 +1,99 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#ifndef PLUGINNPPOPENAI_CHUNKEDJOB_H
+#define PLUGINNPPOPENAI_CHUNKEDJOB_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <functional>
+
+// Part of a large text (byte offsets), `begin` includes the overlap with the previous chunk
+struct TextChunk
+{
+	size_t begin = 0;
+	size_t end = 0;
+};
+
+// Split a UTF-8 text into chunks of max. `chunkSize` bytes, preferably at line ends.
+// Every chunk (except the first) repeats the last ~`overlap` bytes of the previous one as context.
+std::vector<TextChunk> splitTextIntoChunks(const std::string& text, size_t chunkSize, size_t overlap);
+
+// Result of a whole job
+struct ChunkedJobResult
+{
+	bool isOK = false;
+	bool isCancelled = false;
+	std::string text;      // Chunk answers in order (or the answer of the reduce pass)
+	std::string errorText; // First error
+	size_t chunkCount = 0;
+	size_t failedCount = 0;
+};
+
+// Map-reduce over the chunks of a large text: send every chunk with bounded parallelism,
+// stitch the answers back in order, then optionally ask once more to combine them (reduce pass).
+// The backend is a plain callback, so the job doesn't depend on cURL / Notepad++.
+class ChunkedJob : public std::enable_shared_from_this<ChunkedJob>
+{
+public:
+	typedef unsigned long long BackendRequestId; // 0: not sent
+	typedef std::function<void(bool isOK, const std::string& text)> AnswerHandler;
+	typedef std::function<BackendRequestId(const std::string& prompt, AnswerHandler onAnswer)> Backend;
+	typedef std::function<void(BackendRequestId requestId)> BackendCancel;
+	typedef std::function<void(const ChunkedJobResult& result)> FinishHandler;
+
+	// `reducePrompt`: prepended to the stitched answers for the reduce pass (empty: no reduce pass)
+	ChunkedJob(std::vector<std::string> prompts, size_t maxParallel, std::string reducePrompt, Backend backend, BackendCancel backendCancel, FinishHandler onFinish);
+
+	// Create via `std::make_shared()`: the pending answers keep the job alive
+	void start();
+	void cancel();
+
+	// Answered chunks so far / all chunks
+	size_t completedCount() const;
+	size_t chunkCount() const { return _prompts.size(); };
+
+protected:
+	void sendNextChunks();
+	void onChunkAnswer(size_t index, bool isOK, const std::string& text);
+	void onReduceAnswer(bool isOK, const std::string& text);
+	void finish(ChunkedJobResult& result);
+
+	std::vector<std::string> _prompts;
+	std::vector<std::string> _answers;
+	size_t _maxParallel;
+	std::string _reducePrompt;
+	Backend _backend;
+	BackendCancel _backendCancel;
+	FinishHandler _onFinish;
+
+	mutable std::mutex _mutex;
+	size_t _nextIndex = 0;
+	size_t _runningCount = 0;
+	size_t _completedCount = 0;
+	size_t _failedCount = 0;
+	std::string _errorText;
+	bool _isCancelled = false;
+	bool _isFinished = false;
+	std::map<size_t, BackendRequestId> _runningRequests; // Chunk index (reduce pass: `_prompts.size()`) => backend request
+};
+
+
+#endif // PLUGINNPPOPENAI_CHUNKEDJOB_H
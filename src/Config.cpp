@@ -0,0 +1,342 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "Config.h"
+#include "ResponseCache.h"
+#include "Utf8Convert.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Default [API] values, see `configDefault()`
+static const struct
+{
+	const char* key;
+	const char* value;
+} configDefaults[] =
+{
+	{ "secret_key",          "not-required-for-ollama" }, // No API key needed for local Ollama
+	{ "api_url",             "http://localhost:11434" },  // Default Ollama API endpoint; more servers: separated by ','
+	{ "pin_chat",            "1" },          // 1: a chat stays on the server of its first question (its KV cache is reused)
+	{ "proxy_url",           "0" },          // 0: don't use proxy. Trailing '/' will be erased (if any)
+	{ "model",               "deekseek-r1:latest" }, // Default Ollama model
+	{ "temperature",         "0.7" },
+	{ "max_tokens",          "0" },          // 0: Skip `max_tokens` API setting (sent as `num_predict`). Recommended max. value:  <4.000
+	{ "top_p",               "0.8" },
+	{ "frequency_penalty",   "0" },
+	{ "presence_penalty",    "0" },
+	{ "stream",              "1" },          // 1: stream the response (NDJSON) and insert it while it's generated; 0: wait for the whole response
+	{ "parallel_requests",   "4" },          // Max. number of requests sent to Ollama at the same time (others are queued)
+	{ "chat_api",            "1" },          // Chat mode -- 1: send the history as `messages` to /api/chat; 0: send the previous `context` to /api/generate
+	{ "num_ctx",             "4096" },       // Context length (tokens) of the model, sent as `num_ctx` and used for the chat history budget
+	{ "chunk_size",          "8000" },       // Ask in chunks: max. bytes of text per request (min. 256)
+	{ "chunk_overlap",       "200" },        // Ask in chunks: bytes repeated from the end of the previous chunk (less than half a chunk)
+	{ "reduce_prompt",       "" },           // Ask in chunks: combine the answers with this prompt (e.g. "Summarize these summaries:"), empty to just join them
+	{ "cache_size",          "32" },         // Response cache size (MB), 0: disabled
+	{ "cache_random",        "0" },          // 1: cache the answers even if `temperature` > 0 (the same question would get another answer)
+	{ "disk_cache_size",     "64" },         // Response cache file size (MB), kept across sessions, 0: disabled
+	{ "semantic_threshold",  "0" },          // Min. cosine similarity of a similar question's embedding to reuse its answer (e.g. 0.95), 0: disabled
+	{ "semantic_cache_size", "500" },        // Similar questions kept (answers + embeddings)
+	{ "embed_model",         "all-minilm" }, // Embedding model of the questions (`/api/embed`), a small one is enough
+};
+
+// Default of an [API] value (UTF-8), `nullptr` for an unknown key
+const char* configDefault(const char* key)
+{
+	for (const auto& item : configDefaults)
+	{
+		if (strcmp(item.key, key) == 0)
+		{
+			return item.value;
+		}
+	}
+	return nullptr;
+}
+
+ConfigStore::ConfigStore()
+{
+	std::string configErrors;
+	_config = parseConfig(ConfigValues(), "", configErrors); // The defaults
+}
+
+// The current snapshot, valid as long as the caller holds it
+std::shared_ptr<const Config> ConfigStore::get() const
+{
+	return std::atomic_load(&_config);
+}
+
+// Publish a new snapshot; readers holding the previous one are not affected
+void ConfigStore::set(std::shared_ptr<const Config> config)
+{
+	std::atomic_store(&_config, std::move(config));
+}
+
+// Read a whole text file with one read, as UTF-8 with LF line ends: UTF-16LE / UTF-8 BOMs are detected, other non-UTF-8 text is taken as ANSI
+bool readConfigText(const ConfigPath& path, std::string& text)
+{
+	text.clear();
+#ifdef _WIN32
+	FILE* file = _wfopen(path.c_str(), L"rb");
+#else
+	FILE* file = fopen(path.c_str(), "rb");
+#endif
+	if (!file)
+	{
+		return false;
+	}
+	std::string bytes;
+	if (fseek(file, 0, SEEK_END) == 0)
+	{
+		long size = ftell(file);
+		if (size > 0 && fseek(file, 0, SEEK_SET) == 0)
+		{
+			bytes.resize((size_t)size);
+			bytes.resize(fread(&bytes[0], 1, bytes.size(), file));
+		}
+	}
+	fclose(file);
+
+	if (bytes.size() >= 2 && (unsigned char)bytes[0] == 0xFF && (unsigned char)bytes[1] == 0xFE)
+	{
+		// UTF-16LE: e.g. written by `_wfopen(..., L"w, ccs=UNICODE")` / `WritePrivateProfileString()` into a Unicode file
+		std::vector<char16_t> units((bytes.size() - 2) / 2);
+		for (size_t i = 0; i < units.size(); i++)
+		{
+			units[i] = (char16_t)((unsigned char)bytes[2 + i * 2] | ((unsigned char)bytes[3 + i * 2] << 8));
+		}
+		text.resize(units.size() * 3);
+		text.resize(convertUtf16ToUtf8(units.data(), units.size(), units.empty() ? nullptr : &text[0]));
+	}
+	else if (bytes.size() >= 3 && bytes.compare(0, 3, "\xEF\xBB\xBF") == 0)
+	{
+		text = bytes.substr(3);
+	}
+	else if (isValidUtf8(bytes.data(), bytes.size()))
+	{
+		text.swap(bytes);
+	}
+	else
+	{
+#ifdef _WIN32
+		int length = ::MultiByteToWideChar(CP_ACP, 0, bytes.data(), (int)bytes.size(), NULL, 0);
+		std::wstring wideText((size_t)length, L'\0');
+		if (length > 0)
+		{
+			::MultiByteToWideChar(CP_ACP, 0, bytes.data(), (int)bytes.size(), &wideText[0], length);
+		}
+		text = wideToUtf8(wideText);
+#else
+		for (char byte : bytes)
+		{
+			unsigned char latin1 = (unsigned char)byte; // Latin-1
+			if (latin1 < 0x80)
+			{
+				text += byte;
+			}
+			else
+			{
+				text += (char)(0xC0 | (latin1 >> 6));
+				text += (char)(0x80 | (latin1 & 0x3F));
+			}
+		}
+#endif
+	}
+
+	// Text mode line ends
+	size_t lineEnd = 0;
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		if (text[i] != '\r' || i + 1 >= text.size() || text[i + 1] != '\n')
+		{
+			text[lineEnd++] = text[i];
+		}
+	}
+	text.resize(lineEnd);
+	return true;
+}
+
+static std::string toLowerASCII(std::string text)
+{
+	for (char& c : text)
+	{
+		if (c >= 'A' && c <= 'Z')
+		{
+			c = (char)(c - 'A' + 'a');
+		}
+	}
+	return text;
+}
+
+static std::string trimSpaces(const std::string& text, size_t begin, size_t end)
+{
+	while (begin < end && (text[begin] == ' ' || text[begin] == '\t'))
+	{
+		begin++;
+	}
+	while (end > begin && (text[end - 1] == ' ' || text[end - 1] == '\t'))
+	{
+		end--;
+	}
+	return text.substr(begin, end - begin);
+}
+
+// The values of an INI `[section]`: names are case-insensitive, the first one wins (like `GetPrivateProfileString()`)
+ConfigValues parseIniSection(const std::string& text, const char* section)
+{
+	ConfigValues values;
+	std::string sectionName = toLowerASCII(section);
+	bool isInSection = false;
+	size_t lineBegin = 0;
+	while (lineBegin < text.size())
+	{
+		size_t lineEnd = text.find('\n', lineBegin);
+		if (lineEnd == std::string::npos)
+		{
+			lineEnd = text.size();
+		}
+		std::string line = trimSpaces(text, lineBegin, lineEnd);
+		lineBegin = lineEnd + 1;
+
+		if (line.size() >= 2 && line[0] == '[')
+		{
+			size_t sectionEnd = line.find(']');
+			isInSection = (sectionEnd != std::string::npos && toLowerASCII(trimSpaces(line, 1, sectionEnd)) == sectionName);
+			continue;
+		}
+		size_t separator = line.find('=');
+		if (!isInSection || line.empty() || line[0] == ';' || separator == std::string::npos)
+		{
+			continue;
+		}
+		std::string value = trimSpaces(line, separator + 1, line.size());
+		if (value.size() >= 2 && (value[0] == '"' || value[0] == '\'') && value.back() == value[0])
+		{
+			value = value.substr(1, value.size() - 2); // Quotes are stripped like `GetPrivateProfileString()` does
+		}
+		values.emplace(toLowerASCII(trimSpaces(line, 0, separator)), value);
+	}
+	return values;
+}
+
+// A numeric value; a missing one is the default, an invalid one too, and is listed in `configErrors`
+#define CONFIG_MIN_CHUNK_SIZE 256 // Smaller chunks are mostly overlap + cut lines
+
+static double parseConfigNumber(const ConfigValues& values, const char* key, double minValue, double maxValue, bool isInteger, std::string& configErrors)
+{
+	double defaultValue = strtod(configDefault(key), nullptr);
+	ConfigValues::const_iterator value = values.find(key);
+	if (value == values.end())
+	{
+		return defaultValue;
+	}
+	char* end = nullptr;
+	double number = strtod(value->second.c_str(), &end);
+	if (value->second.empty() || *end != '\0' || !(number >= minValue && number <= maxValue) || (isInteger && number != (double)(long long)number))
+	{
+		configErrors += std::string(key) + " = \"" + value->second + "\"\n";
+		return defaultValue;
+	}
+	return number;
+}
+
+static std::string getConfigText(const ConfigValues& values, const char* key)
+{
+	ConfigValues::const_iterator value = values.find(key);
+	return (value == values.end()) ? configDefault(key) : value->second;
+}
+
+static std::string trimConfigURL(std::string URL)
+{
+	URL.erase(URL.find_last_not_of("/") + 1);
+	return URL;
+}
+
+// `api_url` list: separated by ',', ';' or white space
+static std::vector<std::string> splitConfigURLs(const std::string& URLs)
+{
+	std::vector<std::string> items;
+	size_t begin = 0;
+	while ((begin = URLs.find_first_not_of(",; \t", begin)) != std::string::npos)
+	{
+		size_t end = URLs.find_first_of(",; \t", begin);
+		std::string URL = trimConfigURL(URLs.substr(begin, (end == std::string::npos) ? std::string::npos : end - begin));
+		if (!URL.empty() && std::find(items.begin(), items.end(), URL) == items.end())
+		{
+			items.push_back(URL);
+		}
+		begin = end;
+	}
+	return items;
+}
+
+// Parse + validate the [API] values once: missing values get the defaults, invalid ones too, and are listed in `configErrors` (UTF-8)
+std::shared_ptr<Config> parseConfig(const ConfigValues& values, const std::string& instructions, std::string& configErrors)
+{
+	std::shared_ptr<Config> config = std::make_shared<Config>();
+	config->baseURLs = splitConfigURLs(getConfigText(values, "api_url"));
+	if (config->baseURLs.empty())
+	{
+		config->baseURLs = splitConfigURLs(configDefault("api_url"));
+	}
+	for (const std::string& baseURL : config->baseURLs)
+	{
+		config->baseURL += (config->baseURL.empty() ? "" : ",") + baseURL;
+	}
+	config->isChatPinned = (getConfigText(values, "pin_chat") != "0");
+	config->proxyURL = trimConfigURL(getConfigText(values, "proxy_url"));
+	config->isStream = (getConfigText(values, "stream") != "0");
+	config->isChatAPI = (getConfigText(values, "chat_api") != "0");
+	config->parallelRequests = (int)parseConfigNumber(values, "parallel_requests", 1, 999, true, configErrors);
+	config->chunkSize = (size_t)parseConfigNumber(values, "chunk_size", CONFIG_MIN_CHUNK_SIZE, INT_MAX, true, configErrors);
+	config->chunkOverlap = (size_t)parseConfigNumber(values, "chunk_overlap", 0, (double)(config->chunkSize / 2 - 1), true, configErrors); // Every chunk must bring new text
+	if (config->chunkOverlap >= config->chunkSize / 2)
+	{
+		config->chunkOverlap = config->chunkSize / 2 - 1; // The default is too big for this `chunk_size`
+	}
+	config->reducePrompt = getConfigText(values, "reduce_prompt");
+	config->cacheBytes = (size_t)parseConfigNumber(values, "cache_size", 0, 4095, true, configErrors) * 1024 * 1024;
+	config->isCacheRandom = (getConfigText(values, "cache_random") == "1");
+	config->diskCacheBytes = (size_t)parseConfigNumber(values, "disk_cache_size", 0, 4095, true, configErrors) * 1024 * 1024;
+	config->semanticThreshold = (float)parseConfigNumber(values, "semantic_threshold", 0.0, 1.0, false, configErrors);
+	config->semanticCacheSize = (size_t)parseConfigNumber(values, "semantic_cache_size", 0, 1000000, true, configErrors);
+	config->embedModel = getConfigText(values, "embed_model");
+
+	RequestTemplate::Settings settings;
+	settings.model = getConfigText(values, "model");
+	settings.temperature = parseConfigNumber(values, "temperature", 0.0, 100.0, false, configErrors);
+	settings.topP = parseConfigNumber(values, "top_p", 0.0, 1.0, false, configErrors);
+	settings.maxTokens = (int)parseConfigNumber(values, "max_tokens", 0, INT_MAX, true, configErrors);
+	settings.contextLength = (int)parseConfigNumber(values, "num_ctx", 0, INT_MAX, true, configErrors);
+	settings.instructions = instructions;
+	config->requestTemplate.compile(settings);
+
+	uint64_t sourceHash = hashBytes(instructions.data(), instructions.size());
+	for (const ConfigValues::value_type& value : values)
+	{
+		sourceHash = hashBytes(value.first.data(), value.first.size(), sourceHash);
+		sourceHash = hashBytes(value.second.data(), value.second.size(), sourceHash + 1);
+	}
+	config->sourceHash = sourceHash;
+	return config;
+}
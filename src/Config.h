@@ -0,0 +1,91 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#ifndef PLUGINNPPOPENAI_CONFIG_H
+#define PLUGINNPPOPENAI_CONFIG_H
+
+#include "RequestTemplate.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+typedef std::wstring ConfigPath;
+#else
+typedef std::string ConfigPath;
+#endif
+
+// Raw `key=value` pairs of an INI section (lower-case keys, UTF-8)
+typedef std::map<std::string, std::string> ConfigValues;
+
+// The [API] settings + instructions, parsed and validated once by `loadConfig()` (UTF-8 strings, typed numbers).
+// Immutable once published: a request keeps the snapshot it started with, Load Config publishes a new one.
+// Every value is set by `parseConfig()` (the defaults are in `configDefault()`).
+struct Config
+{
+	std::string baseURL;                 // Every `baseURLs` item, joined by ',' (e.g. for cache keys)
+	std::vector<std::string> baseURLs;   // Ollama servers (without trailing '/'), >= 1 item
+	bool isChatPinned = false;           // A chat stays on the server of its first question (its KV cache is reused)
+	std::string proxyURL;                // "0": no proxy; without trailing '/'
+	bool isStream = false;
+	bool isChatAPI = false;              // Chat via `/api/chat` (history), otherwise `/api/generate` (`context`)
+	int parallelRequests = 1;            // >= 1
+	size_t chunkSize = 0;                // Ask in chunks: bytes per request, >= 256
+	size_t chunkOverlap = 0;             // < `chunkSize` / 2
+	std::string reducePrompt;
+	size_t cacheBytes = 0;               // 0: response caches disabled
+	bool isCacheRandom = false;          // Cache answers with `temperature` > 0 too
+	size_t diskCacheBytes = 0;           // 0 (or no `cacheBytes`): disabled
+	float semanticThreshold = 0.0f;      // 0: semantic cache disabled
+	size_t semanticCacheSize = 0;
+	std::string embedModel;
+	RequestTemplate requestTemplate;     // Model, options, instructions
+	uint64_t sourceHash = 0;             // Of the values + instructions it was parsed from
+};
+
+// Default of an [API] value (UTF-8): written to a new config file, and used by `parseConfig()` for a missing or invalid value.
+// The one list of the defaults; `nullptr` for an unknown key.
+const char* configDefault(const char* key);
+
+// Read a whole text file with one read, as UTF-8 with LF line ends: UTF-16LE / UTF-8 BOMs are detected, other non-UTF-8 text is taken as ANSI
+bool readConfigText(const ConfigPath& path, std::string& text);
+
+// The values of an INI `[section]`: names are case-insensitive, the first one wins (like `GetPrivateProfileString()`)
+ConfigValues parseIniSection(const std::string& text, const char* section);
+
+// Parse + validate the [API] values once: missing values get the defaults, invalid ones too, and are listed in `configErrors` (UTF-8)
+std::shared_ptr<Config> parseConfig(const ConfigValues& values, const std::string& instructions, std::string& configErrors);
+
+// Holds the current `Config`, any thread: `get()` + `set()` use the atomic `shared_ptr` functions, which are NOT lock-free
+// (libstdc++ and MSVC guard them with a small internal spinlock/mutex pool, see `std::atomic_is_lock_free()`);
+// a reader only holds it for the reference count copy, never while a config file is read or parsed
+class ConfigStore
+{
+public:
+	ConfigStore();
+
+	std::shared_ptr<const Config> get() const;
+	void set(std::shared_ptr<const Config> config);
+
+protected:
+	std::shared_ptr<const Config> _config;
+};
+
+
+#endif // PLUGINNPPOPENAI_CONFIG_H
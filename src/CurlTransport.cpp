@@ -0,0 +1,206 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#include "CurlTransport.h"
+
+// Init cURL once (in Windows, this will init the winsock stuff) + create the shared connection cache
+bool CurlTransport::init()
+{
+	if (_isInitialized)
+	{
+		return true;
+	}
+
+	if (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK)
+	{
+		return false;
+	}
+
+	// Share connections + DNS results between all pooled handles
+	_share = curl_share_init();
+	if (_share)
+	{
+		curl_share_setopt(_share, CURLSHOPT_LOCKFUNC, lockShare);
+		curl_share_setopt(_share, CURLSHOPT_UNLOCKFUNC, unlockShare);
+		curl_share_setopt(_share, CURLSHOPT_USERDATA, this);
+		curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+		curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+		curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+	}
+
+	_headerList = curl_slist_append(_headerList, "Content-Type: application/json");
+	_isInitialized = true;
+	return true;
+}
+
+// Close pooled handles (and their connections), then cURL itself
+void CurlTransport::cleanup()
+{
+	if (!_isInitialized)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (CURL* curl : _idleHandles)
+		{
+			curl_easy_cleanup(curl);
+		}
+		_idleHandles.clear();
+	}
+
+	if (_share)
+	{
+		curl_share_cleanup(_share);
+		_share = nullptr;
+	}
+	curl_slist_free_all(_headerList);
+	_headerList = nullptr;
+	curl_global_cleanup();
+	_isInitialized = false;
+}
+
+// Leave everything allocated (pooled handles, share, cURL itself) + make `cleanup()` a no-op:
+// for a shutdown where another thread may still be inside cURL
+void CurlTransport::abandon()
+{
+	_isInitialized = false;
+}
+
+void CurlTransport::setCACertPath(const std::string& CACertPath)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_CACertPath = CACertPath;
+}
+
+void CurlTransport::setUserAgent(const std::string& userAgent)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_userAgent = userAgent;
+}
+
+// Reuse an idle handle if possible
+CURL* CurlTransport::acquireHandle()
+{
+	if (!_isInitialized)
+	{
+		return nullptr;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!_idleHandles.empty())
+		{
+			CURL* curl = _idleHandles.back();
+			_idleHandles.pop_back();
+			return curl;
+		}
+	}
+
+	CURL* curl = curl_easy_init();
+	if (curl)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stats.handlesCreated++;
+	}
+	return curl;
+}
+
+// Set the per-request + common options; `curl_easy_reset()` keeps the open connections
+void CurlTransport::prepareRequest(CURL* curl, const std::string& URL, const std::string& proxyURL, const std::string& postFields, CurlWriteFunction writeFunction, void* writeData)
+{
+	curl_easy_reset(curl);
+
+	curl_easy_setopt(curl, CURLOPT_URL, URL.c_str());
+	if (proxyURL != "" && proxyURL != "0")
+	{
+		curl_easy_setopt(curl, CURLOPT_PROXY, proxyURL.c_str());
+	}
+	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt(curl, CURLOPT_HTTPPROXYTUNNEL, 1L); // Corp. proxies etc.
+	{
+		std::lock_guard<std::mutex> lock(_mutex); // cURL copies the strings
+		if (!_CACertPath.empty())
+		{
+			curl_easy_setopt(curl, CURLOPT_CAINFO, _CACertPath.c_str());
+		}
+		curl_easy_setopt(curl, CURLOPT_USERAGENT, _userAgent.c_str());
+	}
+	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, _headerList);
+	curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postFields.c_str()); // NOT copied: keep `postFields` alive until the transfer ends
+	curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)postFields.size());
+	curl_easy_setopt(curl, CURLOPT_POST, 1L);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, writeData);
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeFunction);
+
+	// Keep idle connections alive between requests
+	curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+	curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, 60L);
+	curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 30L);
+	if (_share)
+	{
+		curl_easy_setopt(curl, CURLOPT_SHARE, _share);
+	}
+}
+
+// `CURLINFO_NUM_CONNECTS` is 0 if the transfer used an already open connection
+void CurlTransport::releaseHandle(CURL* curl)
+{
+	if (!curl)
+	{
+		return;
+	}
+
+	long numConnects = 0;
+	curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &numConnects);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_stats.requests++;
+	_stats.connectionsOpened += numConnects;
+	if (numConnects == 0)
+	{
+		_stats.connectionsReused++;
+	}
+
+	if (_idleHandles.size() < maxIdleHandles)
+	{
+		_idleHandles.push_back(curl);
+	}
+	else
+	{
+		curl_easy_cleanup(curl);
+	}
+}
+
+CurlTransportStats CurlTransport::stats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _stats;
+}
+
+// Share object locking (connection cache is used from several threads)
+void CurlTransport::lockShare(CURL*, curl_lock_data data, curl_lock_access, void* userp)
+{
+	static_cast<CurlTransport*>(userp)->_shareMutexes[data].lock();
+}
+
+void CurlTransport::unlockShare(CURL*, curl_lock_data data, void* userp)
+{
+	static_cast<CurlTransport*>(userp)->_shareMutexes[data].unlock();
+}
@@ -0,0 +1,89 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#ifndef PLUGINNPPOPENAI_CURLTRANSPORT_H
+#define PLUGINNPPOPENAI_CURLTRANSPORT_H
+
+#ifndef CURL_STATICLIB
+#define CURL_STATICLIB // Linked statically (as in `PluginDefinition.h`): no `dllimport` declarations
+#endif
+#include <curl/curl.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// cURL write callback type used by the plugin (`OpenAIcURLCallback`, `OllamaStreamCallback`)
+typedef size_t (*CurlWriteFunction)(void* contents, size_t size, size_t nmemb, void* userp);
+
+// Connection counters, see `CurlTransport::stats()`
+struct CurlTransportStats
+{
+	unsigned long long requests          = 0; // Finished transfers
+	unsigned long long connectionsOpened = 0; // New TCP (+TLS) connections
+	unsigned long long connectionsReused = 0; // Transfers served on an already open (keep-alive) connection
+	unsigned long long handlesCreated    = 0; // `curl_easy_init()` calls
+};
+
+// Long-lived cURL state shared by every request:
+// - `curl_global_init()` runs once
+// - easy handles are pooled, and a share object keeps the connection + DNS cache, so keep-alive connections survive between requests
+// - the header list, CA bundle path and user agent are prepared once
+class CurlTransport
+{
+public:
+	CurlTransport() = default;
+	~CurlTransport() { cleanup(); };
+
+	bool init();
+	void cleanup();
+	void abandon();
+	bool isInitialized() const { return _isInitialized; };
+
+	void setCACertPath(const std::string& CACertPath);
+	void setUserAgent(const std::string& userAgent);
+
+	// Get a pooled (or new) easy handle + set the common options of a JSON POST request
+	CURL* acquireHandle();
+	void prepareRequest(CURL* curl, const std::string& URL, const std::string& proxyURL, const std::string& postFields, CurlWriteFunction writeFunction, void* writeData);
+
+	// Update the counters and give the handle back to the pool (its connection stays open)
+	void releaseHandle(CURL* curl);
+
+	CurlTransportStats stats() const;
+
+protected:
+	static void lockShare(CURL* curl, curl_lock_data data, curl_lock_access access, void* userp);
+	static void unlockShare(CURL* curl, curl_lock_data data, void* userp);
+
+	bool _isInitialized = false;
+	CURLSH* _share = nullptr;
+	struct curl_slist* _headerList = nullptr;
+	std::mutex _shareMutexes[CURL_LOCK_DATA_LAST];
+
+	mutable std::mutex _mutex; // Guards the members below
+	std::vector<CURL*> _idleHandles;
+	std::string _CACertPath;
+	std::string _userAgent;
+	CurlTransportStats _stats;
+
+	static const size_t maxIdleHandles = 8;
+};
+
+
+#endif // PLUGINNPPOPENAI_CURLTRANSPORT_H
@@ -0,0 +1,668 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#include "DiskCache.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#endif
+
+#define DISKCACHE_FILE_MAGIC     "NOLLCACH"
+#define DISKCACHE_FILE_VERSION   1
+#define DISKCACHE_RECORD_MAGIC   0x31524344 // "DCR1"
+#define DISKCACHE_MAX_CONTEXT    (16 * 1024 * 1024) // Sanity limit of a record's `context` (ints)
+#define DISKCACHE_MIN_COMPACTION (1024 * 1024)      // Don't rewrite small files just for their superseded records
+
+#ifdef _WIN32
+#define DISKCACHE_TMP_SUFFIX L".tmp"
+#else
+#define DISKCACHE_TMP_SUFFIX ".tmp"
+#endif
+
+
+//
+// DiskFile
+//
+
+#ifdef _WIN32
+
+bool DiskFile::open(const DiskCachePath& path)
+{
+	close();
+	_file = ::CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!::GetFileSizeEx(_file, &fileSize))
+	{
+		close();
+		return false;
+	}
+	_size = (uint64_t)fileSize.QuadPart;
+	return true;
+}
+
+void DiskFile::close()
+{
+	unmap();
+	if (_file != INVALID_HANDLE_VALUE)
+	{
+		::CloseHandle(_file);
+		_file = INVALID_HANDLE_VALUE;
+	}
+	_size = 0;
+}
+
+bool DiskFile::isOpen() const
+{
+	return _file != INVALID_HANDLE_VALUE;
+}
+
+bool DiskFile::append(const char* data, size_t length)
+{
+	OVERLAPPED overlapped = { 0, };
+	overlapped.Offset = (DWORD)_size;
+	overlapped.OffsetHigh = (DWORD)(_size >> 32);
+	DWORD written = 0;
+	if (!::WriteFile(_file, data, (DWORD)length, &written, &overlapped) || written != length)
+	{
+		truncate(_size); // Drop a partial write
+		return false;
+	}
+	_size += length;
+	return true;
+}
+
+bool DiskFile::truncate(uint64_t size)
+{
+	unmap(); // A mapped file can't be shortened
+	LARGE_INTEGER position;
+	position.QuadPart = (LONGLONG)size;
+	if (!::SetFilePointerEx(_file, position, NULL, FILE_BEGIN) || !::SetEndOfFile(_file))
+	{
+		return false;
+	}
+	_size = size;
+	return true;
+}
+
+bool DiskFile::flush()
+{
+	return ::FlushFileBuffers(_file) != FALSE;
+}
+
+const char* DiskFile::map()
+{
+	if (_size == 0 || (_view && _viewSize == _size))
+	{
+		return _size == 0 ? nullptr : _view;
+	}
+	unmap();
+	_mapping = ::CreateFileMappingW(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (_mapping == NULL)
+	{
+		return nullptr;
+	}
+	_view = (const char*)::MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (_view == nullptr)
+	{
+		unmap();
+		return nullptr;
+	}
+	_viewSize = _size;
+	return _view;
+}
+
+void DiskFile::unmap()
+{
+	if (_view)
+	{
+		::UnmapViewOfFile(_view);
+		_view = nullptr;
+	}
+	if (_mapping != NULL)
+	{
+		::CloseHandle(_mapping);
+		_mapping = NULL;
+	}
+	_viewSize = 0;
+}
+
+static bool replaceFile(const DiskCachePath& from, const DiskCachePath& to)
+{
+	return ::MoveFileExW(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+}
+
+static void removeFile(const DiskCachePath& path)
+{
+	::DeleteFileW(path.c_str());
+}
+
+#else
+
+bool DiskFile::open(const DiskCachePath& path)
+{
+	close();
+	_file = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (_file < 0)
+	{
+		return false;
+	}
+	struct stat fileStat;
+	if (::fstat(_file, &fileStat) != 0)
+	{
+		close();
+		return false;
+	}
+	_size = (uint64_t)fileStat.st_size;
+	return true;
+}
+
+void DiskFile::close()
+{
+	unmap();
+	if (_file >= 0)
+	{
+		::close(_file);
+		_file = -1;
+	}
+	_size = 0;
+}
+
+bool DiskFile::isOpen() const
+{
+	return _file >= 0;
+}
+
+bool DiskFile::append(const char* data, size_t length)
+{
+	size_t written = 0;
+	while (written < length)
+	{
+		ssize_t result = ::pwrite(_file, data + written, length - written, (off_t)(_size + written));
+		if (result <= 0)
+		{
+			truncate(_size); // Drop a partial write
+			return false;
+		}
+		written += (size_t)result;
+	}
+	_size += length;
+	return true;
+}
+
+bool DiskFile::truncate(uint64_t size)
+{
+	unmap();
+	if (::ftruncate(_file, (off_t)size) != 0)
+	{
+		return false;
+	}
+	_size = size;
+	return true;
+}
+
+bool DiskFile::flush()
+{
+	return ::fsync(_file) == 0;
+}
+
+const char* DiskFile::map()
+{
+	if (_size == 0 || (_view && _viewSize == _size))
+	{
+		return _size == 0 ? nullptr : _view;
+	}
+	unmap();
+	void* view = ::mmap(nullptr, (size_t)_size, PROT_READ, MAP_SHARED, _file, 0);
+	if (view == MAP_FAILED)
+	{
+		return nullptr;
+	}
+	_view = (const char*)view;
+	_viewSize = _size;
+	return _view;
+}
+
+void DiskFile::unmap()
+{
+	if (_view)
+	{
+		::munmap((void*)_view, (size_t)_viewSize);
+		_view = nullptr;
+	}
+	_viewSize = 0;
+}
+
+static bool replaceFile(const DiskCachePath& from, const DiskCachePath& to)
+{
+	return ::rename(from.c_str(), to.c_str()) == 0;
+}
+
+static void removeFile(const DiskCachePath& path)
+{
+	::unlink(path.c_str());
+}
+
+#endif // _WIN32
+
+
+//
+// DiskCache
+//
+
+static uint64_t recordPayloadLength(uint32_t keyLength, uint32_t responseLength, uint32_t contextCount)
+{
+	return (uint64_t)keyLength + responseLength + (uint64_t)contextCount * sizeof(int32_t);
+}
+
+static uint64_t recordSize(uint64_t payloadLength)
+{
+	return 32 + ((payloadLength + 7) & ~(uint64_t)7); // sizeof(RecordHeader) + payload, 8-byte aligned
+}
+
+// Fields before `checksum` + the payload: a torn write (or garbage after a crash) doesn't match
+static uint64_t recordChecksum(const char* header, const char* payload, uint64_t payloadLength)
+{
+	return hashBytes(payload, (size_t)payloadLength, hashBytes(header, 24)); // offsetof(RecordHeader, checksum)
+}
+
+// Open (or resize) the cache file, 0: disabled (the file is kept)
+void DiskCache::open(const DiskCachePath& path, size_t maxBytes)
+{
+	_isEnabled = (maxBytes > 0);
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (maxBytes == 0 && !_thread.joinable())
+		{
+			return;
+		}
+	}
+	queue([this, path, maxBytes]() { openFile(path, maxBytes); });
+}
+
+// Write the queued answers and stop the cache thread
+void DiskCache::close()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!_thread.joinable())
+		{
+			return;
+		}
+		_isStopping = true;
+	}
+	_wakeUp.notify_one();
+	_thread.join();
+	closeFile();
+	_isEnabled = false;
+}
+
+// `onResult` is called on the cache thread -- keep it short
+void DiskCache::get(const std::string& key, LookupHandler onResult)
+{
+	if (!_isEnabled)
+	{
+		onResult(false, CachedResponse()); // No cache thread just for a miss
+		return;
+	}
+	std::chrono::steady_clock::time_point queueTime = std::chrono::steady_clock::now();
+	queue([this, key, onResult, queueTime]() { lookup(key, onResult, queueTime); });
+}
+
+void DiskCache::put(const std::string& key, const CachedResponse& cachedResponse)
+{
+	if (!_isEnabled)
+	{
+		return;
+	}
+	queue([this, key, cachedResponse]() { store(key, cachedResponse); });
+}
+
+DiskCacheStats DiskCache::stats() const
+{
+	std::lock_guard<std::mutex> lock(_statsMutex);
+	return _stats;
+}
+
+void DiskCache::queue(Task task)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!_thread.joinable())
+		{
+			_isStopping = false;
+			_thread = std::thread(&DiskCache::run, this);
+		}
+		_tasks.push_back(std::move(task));
+	}
+	_wakeUp.notify_one();
+}
+
+// Cache thread: run the queued tasks in order (the remaining ones too when stopping)
+void DiskCache::run()
+{
+	for (;;)
+	{
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_wakeUp.wait(lock, [this]() { return _isStopping || !_tasks.empty(); });
+			if (_tasks.empty())
+			{
+				return;
+			}
+			task = std::move(_tasks.front());
+			_tasks.pop_front();
+		}
+		task();
+	}
+}
+
+void DiskCache::openFile(const DiskCachePath& path, size_t maxBytes)
+{
+	// Same file: new size cap only
+	if (_file.isOpen() && path == _path && maxBytes > 0)
+	{
+		_maxBytes = maxBytes;
+		compactIfNeeded();
+		updateStats();
+		return;
+	}
+
+	closeFile();
+	if (maxBytes == 0)
+	{
+		_isEnabled = false; // Also after a failed/raced `open()` queued before
+		return;
+	}
+	_path = path;
+	_maxBytes = maxBytes;
+	removeFile(_path + DISKCACHE_TMP_SUFFIX); // Left by a crash while compacting
+	if (_file.open(_path) && recover())
+	{
+		compactIfNeeded();
+	}
+	else
+	{
+		_file.close(); // E.g. used by another Notepad++ instance: no disk cache
+	}
+	_isEnabled = _file.isOpen(); // No more `get()`/`put()` tasks if it failed
+	updateStats();
+}
+
+void DiskCache::closeFile()
+{
+	_file.close();
+	_index.clear();
+	_liveBytes = 0;
+	_path.clear();
+	updateStats();
+}
+
+// Rebuild the index from the records; cut off the end of the file from the first invalid record (crash while appending)
+bool DiskCache::recover()
+{
+	_index.clear();
+	_liveBytes = 0;
+
+	const char* view = _file.map();
+	FileHeader fileHeader = { { 0, }, 0, 0 };
+	if (view && _file.size() >= sizeof(FileHeader))
+	{
+		memcpy(&fileHeader, view, sizeof(FileHeader));
+	}
+	if (memcmp(fileHeader.magic, DISKCACHE_FILE_MAGIC, 8) != 0 || fileHeader.version != DISKCACHE_FILE_VERSION)
+	{
+		// New, empty or unknown file: start over
+		memcpy(fileHeader.magic, DISKCACHE_FILE_MAGIC, 8);
+		fileHeader.version = DISKCACHE_FILE_VERSION;
+		fileHeader.reserved = 0;
+		return _file.truncate(0) && _file.append((const char*)&fileHeader, sizeof(FileHeader));
+	}
+
+	uint64_t fileSize = _file.size();
+	uint64_t offset = sizeof(FileHeader);
+	RecordHeader header;
+	while (offset < fileSize && readRecord(view, offset, fileSize, header))
+	{
+		uint64_t size = recordSize(recordPayloadLength(header.keyLength, header.responseLength, header.contextCount));
+		IndexItem& indexItem = _index[header.keyHash];
+		if (indexItem.size > 0)
+		{
+			_liveBytes -= indexItem.size; // Superseded by this newer record
+		}
+		indexItem.offset = offset;
+		indexItem.size = size;
+		indexItem.lastUse = ++_lastUse;
+		_liveBytes += size;
+		offset += size;
+	}
+
+	if (offset < fileSize)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_statsMutex);
+			_stats.recoveredBytes += fileSize - offset;
+		}
+		return _file.truncate(offset);
+	}
+	return true;
+}
+
+// Validate the record at `offset`: complete + matching checksum
+bool DiskCache::readRecord(const char* view, uint64_t offset, uint64_t fileSize, RecordHeader& header) const
+{
+	if (fileSize - offset < sizeof(RecordHeader))
+	{
+		return false;
+	}
+	memcpy(&header, view + offset, sizeof(RecordHeader));
+	if (header.magic != DISKCACHE_RECORD_MAGIC || header.contextCount > DISKCACHE_MAX_CONTEXT)
+	{
+		return false;
+	}
+	uint64_t payloadLength = recordPayloadLength(header.keyLength, header.responseLength, header.contextCount);
+	if (fileSize - offset < recordSize(payloadLength))
+	{
+		return false;
+	}
+	const char* payload = view + offset + sizeof(RecordHeader);
+	return header.checksum == recordChecksum(view + offset, payload, payloadLength)
+		&& header.keyHash == hashBytes(payload, header.keyLength);
+}
+
+void DiskCache::lookup(const std::string& key, const LookupHandler& onResult, std::chrono::steady_clock::time_point queueTime)
+{
+	CachedResponse cachedResponse;
+	bool isFound = false;
+
+	auto indexItem = _index.find(hashBytes(key.data(), key.size()));
+	const char* view = (indexItem != _index.end()) ? _file.map() : nullptr;
+	if (view)
+	{
+		// Validated by `recover()` or written by `store()`: only the key is compared
+		RecordHeader header;
+		memcpy(&header, view + indexItem->second.offset, sizeof(RecordHeader));
+		const char* payload = view + indexItem->second.offset + sizeof(RecordHeader);
+		if (header.keyLength == key.size() && memcmp(payload, key.data(), key.size()) == 0)
+		{
+			cachedResponse.response.assign(payload + header.keyLength, header.responseLength);
+			cachedResponse.context.resize(header.contextCount);
+			if (header.contextCount > 0)
+			{
+				memcpy(&cachedResponse.context[0], payload + header.keyLength + header.responseLength, header.contextCount * sizeof(int32_t));
+			}
+			indexItem->second.lastUse = ++_lastUse;
+			isFound = true;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_statsMutex);
+		(isFound ? _stats.hits : _stats.misses)++;
+		_stats.lookupMicroseconds += (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - queueTime).count();
+	}
+	onResult(isFound, cachedResponse);
+}
+
+// Append a record (replaces the previous answer of the same key in the index)
+void DiskCache::store(const std::string& key, const CachedResponse& cachedResponse)
+{
+	if (!_file.isOpen() || key.size() > UINT32_MAX || cachedResponse.response.size() > UINT32_MAX || cachedResponse.context.size() > DISKCACHE_MAX_CONTEXT)
+	{
+		return;
+	}
+
+	RecordHeader header;
+	header.magic = DISKCACHE_RECORD_MAGIC;
+	header.keyLength = (uint32_t)key.size();
+	header.responseLength = (uint32_t)cachedResponse.response.size();
+	header.contextCount = (uint32_t)cachedResponse.context.size();
+	header.keyHash = hashBytes(key.data(), key.size());
+	header.checksum = 0;
+	uint64_t payloadLength = recordPayloadLength(header.keyLength, header.responseLength, header.contextCount);
+	uint64_t size = recordSize(payloadLength);
+	if (size > _maxBytes)
+	{
+		return;
+	}
+
+	// One write per record: header + payload + padding
+	std::string record((size_t)size, '\0');
+	char* payload = &record[sizeof(RecordHeader)];
+	memcpy(payload, key.data(), key.size());
+	memcpy(payload + key.size(), cachedResponse.response.data(), cachedResponse.response.size());
+	if (!cachedResponse.context.empty())
+	{
+		memcpy(payload + key.size() + cachedResponse.response.size(), &cachedResponse.context[0], cachedResponse.context.size() * sizeof(int32_t));
+	}
+	memcpy(&record[0], &header, sizeof(RecordHeader));
+	header.checksum = recordChecksum(&record[0], payload, payloadLength);
+	memcpy(&record[0], &header, sizeof(RecordHeader));
+
+	uint64_t offset = _file.size();
+	if (!_file.append(record.data(), record.size()))
+	{
+		return;
+	}
+	IndexItem& indexItem = _index[header.keyHash];
+	if (indexItem.size > 0)
+	{
+		_liveBytes -= indexItem.size;
+	}
+	indexItem.offset = offset;
+	indexItem.size = size;
+	indexItem.lastUse = ++_lastUse;
+	_liveBytes += size;
+	{
+		std::lock_guard<std::mutex> lock(_statsMutex);
+		_stats.writes++;
+	}
+
+	compactIfNeeded();
+	updateStats();
+}
+
+// Over the size cap: keep the most recently used 3/4; mostly superseded records: rewrite the live ones
+void DiskCache::compactIfNeeded()
+{
+	if (!_file.isOpen() || _isStopping)
+	{
+		return;
+	}
+	uint64_t fileSize = _file.size();
+	if (fileSize > _maxBytes)
+	{
+		compact((uint64_t)_maxBytes / 4 * 3);
+	}
+	else if (fileSize > DISKCACHE_MIN_COMPACTION && fileSize - sizeof(FileHeader) - _liveBytes > fileSize / 2)
+	{
+		compact(_maxBytes);
+	}
+}
+
+// Write the live records to a new file, oldest use first, then swap it in (a crash leaves either file intact)
+void DiskCache::compact(uint64_t maxBytes)
+{
+	const char* view = _file.map();
+	if (!view)
+	{
+		return;
+	}
+
+	std::vector<IndexItem> items;
+	items.reserve(_index.size());
+	for (auto& indexItem : _index)
+	{
+		items.push_back(indexItem.second);
+	}
+	std::sort(items.begin(), items.end(), [](const IndexItem& a, const IndexItem& b) { return a.lastUse > b.lastUse; });
+	uint64_t keptBytes = sizeof(FileHeader);
+	size_t keptCount = 0;
+	while (keptCount < items.size() && keptBytes + items[keptCount].size <= maxBytes)
+	{
+		keptBytes += items[keptCount].size;
+		keptCount++;
+	}
+
+	DiskCachePath tmpPath = _path + DISKCACHE_TMP_SUFFIX;
+	bool isWritten = false;
+	{
+		DiskFile tmpFile;
+		if (tmpFile.open(tmpPath) && tmpFile.truncate(0))
+		{
+			isWritten = tmpFile.append(view, sizeof(FileHeader));
+			for (size_t i = keptCount; isWritten && i > 0; i--)
+			{
+				isWritten = tmpFile.append(view + items[i - 1].offset, (size_t)items[i - 1].size);
+			}
+			isWritten = isWritten && tmpFile.flush();
+		}
+	}
+
+	DiskCachePath path = _path;
+	_file.close();
+	if (!isWritten || !replaceFile(tmpPath, path))
+	{
+		removeFile(tmpPath);
+	}
+	if (!_file.open(path) || !recover())
+	{
+		_file.close();
+	}
+	std::lock_guard<std::mutex> lock(_statsMutex);
+	_stats.compactions++;
+}
+
+void DiskCache::updateStats()
+{
+	std::lock_guard<std::mutex> lock(_statsMutex);
+	_stats.entries = _index.size();
+	_stats.fileBytes = _file.size();
+	_stats.maxBytes = _maxBytes;
+}
@@ -0,0 +1,172 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#ifndef PLUGINNPPOPENAI_DISKCACHE_H
+#define PLUGINNPPOPENAI_DISKCACHE_H
+
+#include "ResponseCache.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+typedef std::wstring DiskCachePath;
+#else
+typedef std::string DiskCachePath;
+#endif
+
+// A file mapped read-only, written by appending (cache thread)
+class DiskFile
+{
+public:
+	DiskFile() = default;
+	~DiskFile() { close(); };
+	DiskFile(const DiskFile&) = delete;
+	DiskFile& operator=(const DiskFile&) = delete;
+
+	bool open(const DiskCachePath& path);
+	void close();
+	bool isOpen() const;
+
+	uint64_t size() const { return _size; };
+	bool append(const char* data, size_t length);
+	bool truncate(uint64_t size); // Unmaps the file
+	bool flush();
+
+	// Whole file, mapped again if it has grown since the last call (nullptr if empty)
+	const char* map();
+	void unmap();
+
+protected:
+#ifdef _WIN32
+	HANDLE _file = INVALID_HANDLE_VALUE;
+	HANDLE _mapping = NULL;
+#else
+	int _file = -1;
+#endif
+	const char* _view = nullptr;
+	uint64_t _viewSize = 0;
+	uint64_t _size = 0;
+};
+
+struct DiskCacheStats
+{
+	unsigned long long hits        = 0;
+	unsigned long long misses      = 0;
+	unsigned long long writes      = 0;
+	unsigned long long compactions = 0;
+	unsigned long long lookupMicroseconds = 0; // Including the wait in the queue
+	uint64_t recoveredBytes = 0; // Torn/corrupt bytes dropped at the end of the file (crash while writing)
+	size_t entries  = 0;
+	uint64_t fileBytes = 0;
+	size_t maxBytes = 0;
+};
+
+// Answers kept across sessions: an append-only log of records (checksummed), memory-mapped for the lookups.
+// The index (key hash -> record) is rebuilt by scanning the file when it is opened, a torn record at the end is cut off.
+// Every file operation runs on the cache thread, so the callers never wait for the disk;
+// the file is compacted there too: when it exceeds its size cap (least recently used answers are dropped) or is mostly superseded records.
+class DiskCache
+{
+public:
+	typedef std::function<void(bool isFound, const CachedResponse& cachedResponse)> LookupHandler;
+
+	DiskCache() = default;
+	~DiskCache() { close(); };
+	DiskCache(const DiskCache&) = delete;
+	DiskCache& operator=(const DiskCache&) = delete;
+
+	// Open (or resize) the cache file, 0: disabled (the file is kept)
+	void open(const DiskCachePath& path, size_t maxBytes);
+
+	// Write the queued answers and stop the cache thread
+	void close();
+
+	bool isEnabled() const { return _isEnabled; };
+
+	// `onResult` is called on the cache thread -- keep it short (at once on the calling thread if disabled: not found)
+	void get(const std::string& key, LookupHandler onResult);
+	void put(const std::string& key, const CachedResponse& cachedResponse);
+
+	DiskCacheStats stats() const;
+
+protected:
+	// File layout: `FileHeader`, then records (`RecordHeader` + key + response + context, padded to 8 bytes)
+	struct FileHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t reserved;
+	};
+	struct RecordHeader
+	{
+		uint32_t magic;
+		uint32_t keyLength;
+		uint32_t responseLength;
+		uint32_t contextCount;
+		uint64_t keyHash;
+		uint64_t checksum; // Of the fields above + the payload
+	};
+	static_assert(sizeof(FileHeader) == 16 && sizeof(RecordHeader) == 32, "On-disk layout");
+	struct IndexItem
+	{
+		uint64_t offset;
+		uint64_t size;    // Whole record
+		uint64_t lastUse; // Order of use: kept by the compaction
+	};
+
+	typedef std::function<void()> Task;
+	void queue(Task task);
+	void run();
+
+	// Cache thread
+	void openFile(const DiskCachePath& path, size_t maxBytes);
+	void closeFile();
+	bool recover();
+	bool readRecord(const char* view, uint64_t offset, uint64_t fileSize, RecordHeader& header) const;
+	void lookup(const std::string& key, const LookupHandler& onResult, std::chrono::steady_clock::time_point queueTime);
+	void store(const std::string& key, const CachedResponse& cachedResponse);
+	void compactIfNeeded();
+	void compact(uint64_t maxBytes);
+	void updateStats();
+
+	std::thread _thread;
+	std::mutex _mutex; // Guards `_tasks`
+	std::condition_variable _wakeUp;
+	std::deque<Task> _tasks;
+	std::atomic<bool> _isStopping{ false }; // Set under `_mutex` (waited for by `run()`)
+	std::atomic<bool> _isEnabled{ false };
+
+	// Cache thread only
+	DiskCachePath _path;
+	size_t _maxBytes = 0;
+	DiskFile _file;
+	std::unordered_map<uint64_t, IndexItem> _index;
+	uint64_t _liveBytes = 0;
+	uint64_t _lastUse = 0;
+
+	mutable std::mutex _statsMutex;
+	DiskCacheStats _stats;
+};
+
+
+#endif // PLUGINNPPOPENAI_DISKCACHE_H
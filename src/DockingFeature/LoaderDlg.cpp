@@ -21,7 +21,7 @@
 extern NppData nppData;
 
 
-INT_PTR CALLBACK LoaderDlg::run_dlgProc(UINT message, WPARAM, LPARAM) // UINT message, WPARAM wParam, LPARAM lParam
+INT_PTR CALLBACK LoaderDlg::run_dlgProc(UINT message, WPARAM wParam, LPARAM) // UINT message, WPARAM wParam, LPARAM lParam
 {
 	switch (message) 
 	{
@@ -31,6 +31,25 @@ INT_PTR CALLBACK LoaderDlg::run_dlgProc(UINT message, WPARAM, LPARAM) // UINT me
 			return TRUE;
 		}
 
+		// Cancel the running request ("Cancel" button, or Esc while the loader itself has the focus)
+		case WM_COMMAND:
+		{
+			switch (LOWORD(wParam))
+			{
+				case IDCANCEL:
+					if (::GetFocus() != _hSelf && !::IsChild(_hSelf, ::GetFocus()))
+					{
+						return TRUE;
+					}
+					// Fall through
+				case ID_PLUGINNPPOPENAI_LOADING_CANCEL:
+					::EnableWindow(::GetDlgItem(_hSelf, ID_PLUGINNPPOPENAI_LOADING_CANCEL), FALSE); // Avoid double clicks
+					cancelAskOllama();
+					return TRUE;
+			}
+			return FALSE;
+		}
+
 		default :
 			return FALSE;
 	}
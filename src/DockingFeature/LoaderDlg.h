@@ -36,12 +36,14 @@ public:
 		::SendMessage(progressBar, PBM_SETMARQUEE, TRUE, 20); // <-- 20ms seems good (1: too fast; 50: too slow)
 	};
 
-	// Create + show a loader dialog
+	// Create + show a loader dialog WITHOUT activating it: the user may be typing in the editor (Space/Esc must not hit "Cancel")
 	void doDialog(bool isRTL = false) {
 		if (!isCreated())
 			// create(IDD_PLUGINNPPOPENAI, isRTL);
 			create(IDD_PLUGINNPPOPENAI_LOADING, isRTL);
-		display();
+		::EnableWindow(::GetDlgItem(_hSelf, ID_PLUGINNPPOPENAI_LOADING_CANCEL), TRUE);
+		if (!isVisible())
+			::ShowWindow(_hSelf, SW_SHOWNOACTIVATE);
 	};
 
 	// Toggle loader dialog visibility
@@ -25,5 +25,6 @@
 #define	IDD_PLUGINNPPOPENAI_LOADING	2500
 #define	ID_PLUGINNPPOPENAI_LOADING_STATIC	(IDD_PLUGINNPPOPENAI_LOADING + 10)
 #define	ID_PLUGINNPPOPENAI_LOADING_PROGRESS	(IDD_PLUGINNPPOPENAI_LOADING + 20)
+#define	ID_PLUGINNPPOPENAI_LOADING_CANCEL	(IDD_PLUGINNPPOPENAI_LOADING + 30)
 
 #endif // PLUGINNPPOPENAI_LOADERRESOURCE_H
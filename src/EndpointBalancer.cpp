@@ -0,0 +1,202 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "EndpointBalancer.h"
+
+#define ENDPOINT_EWMA_WEIGHT    0.3  // Of the newest latency
+#define ENDPOINT_MIN_LATENCY    0.001
+#define ENDPOINT_MIN_BACKOFF    1000  // ms, ejection after the first failure in a row, doubled by the next ones
+#define ENDPOINT_MAX_BACKOFF    60000
+
+EndpointBalancer::EndpointBalancer()
+	: _random(std::random_device()())
+{
+}
+
+// Keeps the counters of the URLs already known (+ the pinned sessions if the list is the same)
+void EndpointBalancer::setEndpoints(const std::vector<std::string>& baseURLs)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	std::vector<int> activeEndpoints;
+	for (const std::string& baseURL : baseURLs)
+	{
+		size_t endpoint = 0;
+		while (endpoint < _endpoints.size() && _endpoints[endpoint].baseURL != baseURL)
+		{
+			endpoint++;
+		}
+		if (endpoint == _endpoints.size())
+		{
+			EndpointStats stats;
+			stats.baseURL = baseURL;
+			_endpoints.push_back(stats);
+		}
+		activeEndpoints.push_back((int)endpoint);
+	}
+	if (activeEndpoints != _activeEndpoints)
+	{
+		_activeEndpoints.swap(activeEndpoints);
+		_sessions.clear();
+	}
+}
+
+// Not ejected, or its backoff is over and no probe request is running
+bool EndpointBalancer::isAvailable(const EndpointStats& endpoint, std::chrono::steady_clock::time_point time) const
+{
+	return endpoint.consecutiveFailures == 0 || (time >= endpoint.retryTime && endpoint.outstanding == 0);
+}
+
+// Power of two choices among the available endpoints: two random ones, the less loaded one wins (an endpoint without an answer yet is tried first).
+// None available: the one whose backoff ends first (the request fails, but it's not held back)
+int EndpointBalancer::choose()
+{
+	std::chrono::steady_clock::time_point time = now();
+	std::vector<int> candidates;
+	for (int endpoint : _activeEndpoints)
+	{
+		if (isAvailable(_endpoints[endpoint], time))
+		{
+			candidates.push_back(endpoint);
+		}
+	}
+	if (candidates.empty())
+	{
+		int endpoint = -1;
+		for (int activeEndpoint : _activeEndpoints)
+		{
+			if (endpoint < 0 || _endpoints[activeEndpoint].retryTime < _endpoints[endpoint].retryTime)
+			{
+				endpoint = activeEndpoint;
+			}
+		}
+		return endpoint;
+	}
+	if (candidates.size() == 1)
+	{
+		return candidates[0];
+	}
+	size_t firstChoice = _random() % candidates.size();
+	size_t secondChoice = _random() % (candidates.size() - 1);
+	if (secondChoice >= firstChoice)
+	{
+		secondChoice++;
+	}
+	int first = candidates[firstChoice];
+	int second = candidates[secondChoice];
+	const EndpointStats& firstEndpoint = _endpoints[first];
+	const EndpointStats& secondEndpoint = _endpoints[second];
+	if (firstEndpoint.latencyEWMA == 0.0 || secondEndpoint.latencyEWMA == 0.0)
+	{
+		// No latency to compare yet: least outstanding requests
+		if (firstEndpoint.outstanding != secondEndpoint.outstanding)
+		{
+			return (firstEndpoint.outstanding < secondEndpoint.outstanding) ? first : second;
+		}
+		return (firstEndpoint.latencyEWMA == 0.0) ? first : second;
+	}
+	double firstLoad = (double)(firstEndpoint.outstanding + 1) * firstEndpoint.latencyEWMA;
+	double secondLoad = (double)(secondEndpoint.outstanding + 1) * secondEndpoint.latencyEWMA;
+	return (firstLoad <= secondLoad) ? first : second;
+}
+
+// Choose an endpoint for a request (`session` 0: none); -1 if there's none. `release()` it at the end.
+int EndpointBalancer::acquire(uint64_t session, std::string& baseURL)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	int endpoint = -1;
+	if (session != 0)
+	{
+		std::map<uint64_t, int>::const_iterator pinned = _sessions.find(session);
+		if (pinned != _sessions.end() && isAvailable(_endpoints[pinned->second], now()))
+		{
+			endpoint = pinned->second;
+		}
+	}
+	if (endpoint < 0)
+	{
+		endpoint = choose();
+		if (endpoint < 0)
+		{
+			return -1;
+		}
+		if (session != 0)
+		{
+			_sessions[session] = endpoint;
+		}
+	}
+	_endpoints[endpoint].outstanding++;
+	_endpoints[endpoint].requests++;
+	baseURL = _endpoints[endpoint].baseURL;
+	return endpoint;
+}
+
+// `isSample`: `seconds` is the latency of a whole request (not of a cancelled one)
+void EndpointBalancer::release(int endpoint, double seconds, bool isOK, bool isSample)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (endpoint < 0 || endpoint >= (int)_endpoints.size())
+	{
+		return;
+	}
+	EndpointStats& stats = _endpoints[endpoint];
+	if (stats.outstanding > 0)
+	{
+		stats.outstanding--;
+	}
+	if (!isOK)
+	{
+		// Ejected: its (short) failure time is not a latency sample
+		stats.failures++;
+		stats.consecutiveFailures++;
+		long long backoff = ENDPOINT_MAX_BACKOFF;
+		if (stats.consecutiveFailures < 16)
+		{
+			backoff = (long long)ENDPOINT_MIN_BACKOFF << (stats.consecutiveFailures - 1);
+			backoff = (backoff < ENDPOINT_MAX_BACKOFF) ? backoff : ENDPOINT_MAX_BACKOFF;
+		}
+		stats.retryTime = now() + std::chrono::milliseconds(backoff);
+		for (std::map<uint64_t, int>::iterator session = _sessions.begin(); session != _sessions.end(); )
+		{
+			session = (session->second == endpoint) ? _sessions.erase(session) : std::next(session); // Pinned again to a working one
+		}
+		return;
+	}
+	if (!isSample)
+	{
+		return;
+	}
+	stats.consecutiveFailures = 0;
+	seconds = (seconds > ENDPOINT_MIN_LATENCY) ? seconds : ENDPOINT_MIN_LATENCY;
+	stats.latencyEWMA = (stats.latencyEWMA == 0.0) ? seconds : ENDPOINT_EWMA_WEIGHT * seconds + (1.0 - ENDPOINT_EWMA_WEIGHT) * stats.latencyEWMA;
+}
+
+void EndpointBalancer::unpin(uint64_t session)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_sessions.erase(session);
+}
+
+std::vector<EndpointStats> EndpointBalancer::stats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	std::vector<EndpointStats> stats;
+	for (int endpoint : _activeEndpoints)
+	{
+		stats.push_back(_endpoints[endpoint]);
+	}
+	return stats;
+}
@@ -0,0 +1,74 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#ifndef PLUGINNPPOPENAI_ENDPOINTBALANCER_H
+#define PLUGINNPPOPENAI_ENDPOINTBALANCER_H
+
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+// Counters of an endpoint, see `EndpointBalancer::stats()`
+struct EndpointStats
+{
+	std::string baseURL;
+	unsigned long long requests = 0;
+	unsigned long long failures = 0;
+	size_t outstanding = 0;
+	double latencyEWMA = 0.0; // Seconds, 0: no answer yet
+	unsigned consecutiveFailures = 0; // > 0: ejected until `retryTime`, then one probe request at a time until it answers
+	std::chrono::steady_clock::time_point retryTime;
+};
+
+// Spreads the requests over several Ollama servers (`api_url` list): power of two choices,
+// the one with less (outstanding requests + 1) * latency EWMA wins. A failing endpoint is ejected with an exponential backoff
+// (a dead server fails faster than any answer: its latency can't tell it apart). A session (e.g. a chat) can be pinned to its first endpoint (KV cache).
+class EndpointBalancer
+{
+public:
+	EndpointBalancer();
+	virtual ~EndpointBalancer() {};
+
+	// Keeps the counters of the URLs already known (+ the pinned sessions if the list is the same)
+	void setEndpoints(const std::vector<std::string>& baseURLs);
+
+	// Choose an endpoint for a request (`session` 0: none); -1 if there's none. `release()` it at the end.
+	int acquire(uint64_t session, std::string& baseURL);
+	void release(int endpoint, double seconds, bool isOK, bool isSample);
+	void unpin(uint64_t session);
+
+	std::vector<EndpointStats> stats() const; // Of the active endpoints
+
+protected:
+	virtual std::chrono::steady_clock::time_point now() const { return std::chrono::steady_clock::now(); };
+	bool isAvailable(const EndpointStats& endpoint, std::chrono::steady_clock::time_point time) const;
+	int choose();
+
+	mutable std::mutex _mutex; // Guards the members below
+	std::vector<EndpointStats> _endpoints; // Every URL ever set: an index stays valid for `release()`
+	std::vector<int> _activeEndpoints;     // Of the last `setEndpoints()`, in its order
+	std::map<uint64_t, int> _sessions;
+	std::minstd_rand _random;
+};
+
+
+#endif // PLUGINNPPOPENAI_ENDPOINTBALANCER_H
@@ -0,0 +1,259 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "FileWatcher.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#define FILEWATCHER_BUFFER_SIZE 16384
+
+// Start watching `fileNames` (without path) in `directory`; false if the directory can't be watched
+bool FileWatcher::start(const FileWatcherPath& directory, const std::vector<FileWatcherPath>& fileNames, std::chrono::milliseconds debounce, ChangeHandler onChange)
+{
+	stop();
+	_fileNames = fileNames;
+	_debounce = debounce;
+	_onChange = std::move(onChange);
+
+#ifdef _WIN32
+	_directory = ::CreateFileW(directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+		OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+	if (_directory == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	_stopEvent = ::CreateEventW(NULL, TRUE, FALSE, NULL);
+	if (_stopEvent == NULL)
+	{
+		::CloseHandle(_directory);
+		_directory = INVALID_HANDLE_VALUE;
+		return false;
+	}
+#else
+	_inotify = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+	if (_inotify < 0)
+	{
+		return false;
+	}
+	// Editors save in place (IN_CLOSE_WRITE) or write a new file and rename it (IN_MOVED_TO)
+	if (::inotify_add_watch(_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE) < 0 || ::pipe(_stopPipe) != 0)
+	{
+		::close(_inotify);
+		_inotify = -1;
+		return false;
+	}
+#endif
+
+	_thread = std::thread(&FileWatcher::run, this);
+	return true;
+}
+
+void FileWatcher::stop()
+{
+	if (!_thread.joinable())
+	{
+		return;
+	}
+#ifdef _WIN32
+	::SetEvent(_stopEvent);
+	_thread.join();
+	::CloseHandle(_stopEvent);
+	::CloseHandle(_directory);
+	_stopEvent = NULL;
+	_directory = INVALID_HANDLE_VALUE;
+#else
+	char stopByte = 0;
+	ssize_t written = ::write(_stopPipe[1], &stopByte, 1);
+	(void)written;
+	_thread.join();
+	::close(_stopPipe[0]);
+	::close(_stopPipe[1]);
+	::close(_inotify);
+	_stopPipe[0] = _stopPipe[1] = -1;
+	_inotify = -1;
+#endif
+}
+
+FileWatcherStats FileWatcher::stats() const
+{
+	FileWatcherStats stats;
+	stats.events = _events;
+	stats.changes = _changes;
+	return stats;
+}
+
+bool FileWatcher::isWatched(const FileWatcherPath& fileName) const
+{
+	for (const FileWatcherPath& watchedName : _fileNames)
+	{
+#ifdef _WIN32
+		if (_wcsicmp(watchedName.c_str(), fileName.c_str()) == 0)
+#else
+		if (watchedName == fileName)
+#endif
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// A watched file changed: (re)start the quiet period
+void FileWatcher::onEvent(std::chrono::steady_clock::time_point& deadline, bool& isPending)
+{
+	_events++;
+	deadline = std::chrono::steady_clock::now() + _debounce;
+	isPending = true;
+}
+
+#ifdef _WIN32
+// Watcher thread: one overlapped ReadDirectoryChangesW at a time, waited for together with the stop event + the debounce timeout
+void FileWatcher::run()
+{
+	OVERLAPPED overlapped = {};
+	overlapped.hEvent = ::CreateEventW(NULL, TRUE, FALSE, NULL);
+	if (overlapped.hEvent == NULL)
+	{
+		return;
+	}
+	DWORD buffer[FILEWATCHER_BUFFER_SIZE / sizeof(DWORD)]; // FILE_NOTIFY_INFORMATION is DWORD-aligned
+	bool isReading = false;
+	bool isPending = false;
+	std::chrono::steady_clock::time_point deadline;
+	for (;;)
+	{
+		if (!isReading)
+		{
+			if (!::ReadDirectoryChangesW(_directory, buffer, sizeof(buffer), FALSE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE,
+				NULL, &overlapped, NULL))
+			{
+				break;
+			}
+			isReading = true;
+		}
+
+		DWORD timeout = INFINITE;
+		if (isPending)
+		{
+			long long remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+			timeout = (remaining > 0) ? (DWORD)remaining : 0;
+		}
+		HANDLE handles[2] = { _stopEvent, overlapped.hEvent };
+		DWORD waitResult = ::WaitForMultipleObjects(2, handles, FALSE, timeout);
+		if (waitResult == WAIT_OBJECT_0 + 1)
+		{
+			isReading = false;
+			DWORD length = 0;
+			if (!::GetOverlappedResult(_directory, &overlapped, &length, FALSE))
+			{
+				break;
+			}
+			if (length == 0)
+			{
+				onEvent(deadline, isPending); // Too many changes for the buffer: the files may have changed
+				continue;
+			}
+			const char* entry = (const char*)buffer;
+			for (;;)
+			{
+				const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)entry;
+				if (isWatched(FileWatcherPath(info->FileName, info->FileNameLength / sizeof(WCHAR))))
+				{
+					onEvent(deadline, isPending);
+				}
+				if (info->NextEntryOffset == 0)
+				{
+					break;
+				}
+				entry += info->NextEntryOffset;
+			}
+		}
+		else if (waitResult == WAIT_TIMEOUT)
+		{
+			isPending = false;
+			_changes++;
+			_onChange();
+		}
+		else
+		{
+			break; // Stopped (or failed)
+		}
+	}
+
+	if (isReading)
+	{
+		DWORD length = 0;
+		::CancelIoEx(_directory, &overlapped);
+		::GetOverlappedResult(_directory, &overlapped, &length, TRUE); // `buffer` must outlive the read
+	}
+	::CloseHandle(overlapped.hEvent);
+}
+#else
+// Watcher thread: poll inotify + the stop pipe, with the debounce as timeout
+void FileWatcher::run()
+{
+	alignas(struct inotify_event) char buffer[FILEWATCHER_BUFFER_SIZE];
+	bool isPending = false;
+	std::chrono::steady_clock::time_point deadline;
+	for (;;)
+	{
+		int timeout = -1;
+		if (isPending)
+		{
+			long long remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+			timeout = (remaining > 0) ? (int)remaining : 0;
+		}
+		struct pollfd fds[2] = { { _stopPipe[0], POLLIN, 0 }, { _inotify, POLLIN, 0 } };
+		int pollResult = ::poll(fds, 2, timeout);
+		if (pollResult < 0 && errno == EINTR)
+		{
+			continue; // Interrupted by a signal: wait again (with the remaining debounce)
+		}
+		if (pollResult < 0 || (fds[0].revents & POLLIN))
+		{
+			break; // Stopped (or failed)
+		}
+		if (pollResult == 0)
+		{
+			isPending = false;
+			_changes++;
+			_onChange();
+			continue;
+		}
+
+		ssize_t length;
+		while ((length = ::read(_inotify, buffer, sizeof(buffer))) > 0)
+		{
+			for (const char* entry = buffer; entry < buffer + length; )
+			{
+				const struct inotify_event* event = (const struct inotify_event*)entry;
+				if ((event->mask & IN_Q_OVERFLOW) || (event->len > 0 && isWatched(FileWatcherPath(event->name))))
+				{
+					onEvent(deadline, isPending);
+				}
+				entry += sizeof(struct inotify_event) + event->len;
+			}
+		}
+	}
+}
+#endif
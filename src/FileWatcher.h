@@ -0,0 +1,81 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#ifndef PLUGINNPPOPENAI_FILEWATCHER_H
+#define PLUGINNPPOPENAI_FILEWATCHER_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+typedef std::wstring FileWatcherPath;
+#else
+typedef std::string FileWatcherPath;
+#endif
+
+// Watcher counters, see `FileWatcher::stats()`
+struct FileWatcherStats
+{
+	unsigned long long events  = 0; // Changes of the watched files (an editor's save is often several)
+	unsigned long long changes = 0; // `onChange` calls (after the debounce)
+};
+
+// Watches a few files of one directory on its own thread (ReadDirectoryChangesW / inotify):
+// `onChange` is called once the changes have settled for `debounce`, on the watcher thread
+class FileWatcher
+{
+public:
+	typedef std::function<void()> ChangeHandler;
+
+	FileWatcher() = default;
+	~FileWatcher() { stop(); };
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	bool start(const FileWatcherPath& directory, const std::vector<FileWatcherPath>& fileNames, std::chrono::milliseconds debounce, ChangeHandler onChange);
+	void stop(); // Waits for a running `onChange`
+	bool isRunning() const { return _thread.joinable(); };
+
+	FileWatcherStats stats() const;
+
+protected:
+	void run();
+	bool isWatched(const FileWatcherPath& fileName) const;
+	void onEvent(std::chrono::steady_clock::time_point& deadline, bool& isPending);
+
+	std::vector<FileWatcherPath> _fileNames;
+	std::chrono::milliseconds _debounce { 0 };
+	ChangeHandler _onChange;
+	std::thread _thread;
+	std::atomic<unsigned long long> _events { 0 };
+	std::atomic<unsigned long long> _changes { 0 };
+#ifdef _WIN32
+	HANDLE _directory = INVALID_HANDLE_VALUE;
+	HANDLE _stopEvent = NULL;
+#else
+	int _inotify = -1;
+	int _stopPipe[2] = { -1, -1 };
+#endif
+};
+
+
+#endif // PLUGINNPPOPENAI_FILEWATCHER_H
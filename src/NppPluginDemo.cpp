@@ -76,6 +76,12 @@ extern "C" __declspec(dllexport) void beNotified(SCNotification *notifyCode)
 		}
 		break;
 
+		case NPPN_FILECLOSED:
+		{
+			onDocumentClosed(notifyCode->nmhdr.idFrom);
+		}
+		break;
+
 		case NPPN_SHUTDOWN:
 		{
 			commandMenuCleanUp();
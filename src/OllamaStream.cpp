@@ -0,0 +1,252 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#include "OllamaStream.h"
+#include <cstring>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Collect complete lines; only the unterminated tail is copied into `_pendingLine`
+void OllamaStream::feed(const char* data, size_t length)
+{
+	const char* end = data + length;
+	while (data < end)
+	{
+		const char* newLine = static_cast<const char*>(memchr(data, '\n', end - data));
+		if (newLine == nullptr)
+		{
+			_pendingLine.append(data, end);
+			return;
+		}
+
+		if (_pendingLine.empty())
+		{
+			parseLine(data, newLine - data);
+		}
+		else
+		{
+			_pendingLine.append(data, newLine);
+			parseLine(_pendingLine.data(), _pendingLine.size());
+			_pendingLine.clear();
+		}
+		data = newLine + 1;
+	}
+}
+
+// Handle a trailing line without '\n'
+void OllamaStream::finish()
+{
+	if (!_pendingLine.empty())
+	{
+		parseLine(_pendingLine.data(), _pendingLine.size());
+		_pendingLine.clear();
+	}
+}
+
+// Parse one line and pass the chunk to the handler
+void OllamaStream::parseLine(const char* line, size_t length)
+{
+	// Skip "\r" (CRLF) and empty keep-alive lines
+	while (length > 0 && (line[length - 1] == '\r' || line[length - 1] == ' '))
+	{
+		length--;
+	}
+	if (length == 0)
+	{
+		return;
+	}
+
+	OllamaChunk chunk;
+	if (!parseOllamaChunk(line, length, chunk))
+	{
+		_invalidText.append(line, length);
+		_invalidText += '\n';
+		return;
+	}
+
+	_isDone = _isDone || chunk.done;
+	if (_onChunk)
+	{
+		_onChunk(chunk);
+	}
+}
+
+// Single-pass extraction of the known fields (no DOM): the strings are moved into the chunk, `context` is read straight into its vector,
+// other values (e.g. `model`, `created_at`) are only scanned
+class OllamaChunkReader : public nlohmann::json_sax<json>
+{
+public:
+	explicit OllamaChunkReader(OllamaChunk& chunk) : _chunk(chunk) {};
+
+	bool isObject() const { return _isObject; };
+	const std::string& errorText() const { return _errorText; };
+
+	bool null() override { return true; };
+	bool boolean(bool value) override
+	{
+		if (_depth == 1 && _key == "done")
+		{
+			_chunk.done = value;
+		}
+		return true;
+	};
+	bool number_integer(number_integer_t value) override { return readInteger((long long)value); };
+	bool number_unsigned(number_unsigned_t value) override { return readInteger((long long)value); };
+	bool number_float(number_float_t, const string_t&) override { return true; };
+	bool string(string_t& value) override
+	{
+		if (_depth == 1 && _key == "response")
+		{
+			_chunk.response = std::move(value);
+			_chunk.hasResponse = true;
+			_hasTopResponse = true;
+		}
+		else if (_depth == 1 && _key == "error")
+		{
+			_chunk.error = std::move(value);
+		}
+		else if (_depth == 2 && _isInMessage && _key == "content" && !_hasTopResponse)
+		{
+			_chunk.response = std::move(value); // `/api/chat`
+			_chunk.hasResponse = true;
+		}
+		return true;
+	};
+	bool binary(binary_t&) override { return true; };
+
+	bool start_object(std::size_t) override
+	{
+		if (_depth == 0)
+		{
+			_isObject = true;
+		}
+		else if (_depth == 1 && _key == "message")
+		{
+			_isInMessage = true;
+		}
+		_depth++;
+		_key.clear();
+		return _isObject; // A top-level array/value is not a chunk
+	};
+	bool key(string_t& value) override
+	{
+		if (_depth == 1 || (_depth == 2 && _isInMessage))
+		{
+			_key = std::move(value);
+		}
+		return true;
+	};
+	bool end_object() override
+	{
+		_depth--;
+		_key.clear();
+		if (_depth == 1)
+		{
+			_isInMessage = false;
+		}
+		return true;
+	};
+	bool start_array(std::size_t) override
+	{
+		if (_depth == 0)
+		{
+			return false;
+		}
+		if (_depth == 1 && _key == "context")
+		{
+			_isInContext = true;
+			_chunk.context.clear();
+		}
+		_depth++;
+		return true;
+	};
+	bool end_array() override
+	{
+		_depth--;
+		if (_depth == 1)
+		{
+			_isInContext = false;
+			_key.clear();
+		}
+		return true;
+	};
+
+	bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override
+	{
+		_errorText = ex.what();
+		return false;
+	};
+
+protected:
+	bool readInteger(long long value)
+	{
+		if (_depth == 2 && _isInContext)
+		{
+			_chunk.context.push_back((int)value);
+		}
+		else if (_depth == 1 && _key == "prompt_eval_count")
+		{
+			_chunk.promptEvalCount = value;
+		}
+		else if (_depth == 1 && _key == "prompt_eval_duration")
+		{
+			_chunk.promptEvalDuration = value;
+		}
+		else if (_depth == 1 && _key == "eval_count")
+		{
+			_chunk.evalCount = value;
+		}
+		return true;
+	};
+
+	OllamaChunk& _chunk;
+	std::string _key;   // Last key of the top-level object (or of `message`)
+	std::string _errorText;
+	size_t _depth = 0;  // Open objects + arrays
+	bool _isObject = false;
+	bool _isInMessage = false;
+	bool _isInContext = false;
+	bool _hasTopResponse = false; // `response` wins over `message.content`
+};
+
+// Parse a single `/api/generate` stream line (or a whole non-streamed response), e.g. `{"model":"...","response":"Hel","done":false}`:
+// `response` (or `message.content`), `error`, `done` and (last chunk) `context` + metrics -- missing fields keep their defaults
+bool parseOllamaChunk(const char* line, size_t length, OllamaChunk& chunk, std::string* errorText)
+{
+	OllamaChunkReader reader(chunk);
+	bool isParsed = json::sax_parse(line, line + length, &reader);
+	if (!isParsed || !reader.isObject())
+	{
+		if (errorText)
+		{
+			*errorText = reader.errorText().empty() ? "Not a JSON object" : reader.errorText();
+		}
+		return false;
+	}
+
+	// Only the last chunk has a conversation context + metrics
+	if (!chunk.done)
+	{
+		chunk.context.clear();
+		chunk.promptEvalCount = 0;
+		chunk.promptEvalDuration = 0;
+		chunk.evalCount = 0;
+	}
+	return true;
+}
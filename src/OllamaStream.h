@@ -0,0 +1,74 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#ifndef PLUGINNPPOPENAI_OLLAMASTREAM_H
+#define PLUGINNPPOPENAI_OLLAMASTREAM_H
+
+#include <string>
+#include <functional>
+#include <vector>
+
+// One parsed line of an Ollama NDJSON stream (`"stream": true`)
+struct OllamaChunk
+{
+	std::string response; // Text fragment of this chunk (may be empty) -- `response` or `message.content` (`/api/chat`)
+	std::string error;    // Filled if Ollama sent `{"error": ...}` instead of a fragment
+	bool hasResponse = false; // `response` / `message.content` was sent (even if empty)
+	bool done = false;    // Last chunk of the generation
+
+	// Sent with the last chunk only
+	std::vector<int> context;          // Encoded conversation (`/api/generate`), send it back to continue from the cached state
+	long long promptEvalCount    = 0;  // Prompt tokens evaluated (cached ones are not counted)
+	long long promptEvalDuration = 0;  // ns
+	long long evalCount          = 0;  // Generated tokens
+};
+
+// Split the raw cURL byte stream into newline-delimited JSON objects and parse them one by one
+class OllamaStream
+{
+public:
+	typedef std::function<void(const OllamaChunk& chunk)> ChunkHandler;
+
+	explicit OllamaStream(ChunkHandler onChunk) : _onChunk(onChunk) {};
+
+	// Feed the bytes received by the cURL write callback (may end in the middle of a line)
+	void feed(const char* data, size_t length);
+
+	// Parse the last line if it wasn't terminated by '\n' -- call it after the transfer
+	void finish();
+
+	// Ollama sent its `"done": true` chunk
+	bool isDone() const { return _isDone; };
+
+	// Lines which are not JSON (e.g. "404 page not found" from a proxy), kept for error messages
+	const std::string& invalidText() const { return _invalidText; };
+
+protected:
+	void parseLine(const char* line, size_t length);
+
+	ChunkHandler _onChunk;
+	std::string _pendingLine; // Incomplete line carried over to the next `feed()`
+	std::string _invalidText;
+	bool _isDone = false;
+};
+
+// Parse a single NDJSON line (or a non-streamed response) without building a DOM; returns `false` for non-JSON lines (reason in `errorText`)
+bool parseOllamaChunk(const char* line, size_t length, OllamaChunk& chunk, std::string* errorText = nullptr);
+
+
+#endif // PLUGINNPPOPENAI_OLLAMASTREAM_H
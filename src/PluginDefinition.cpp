@@ -18,19 +18,27 @@
 #include "PluginDefinition.h"
 #include "DockingFeature/LoaderDlg.h"
 #include "DockingFeature/ChatSettingsDlg.h"
+#include "OllamaStream.h"
+#include "CurlTransport.h"
+#include "EndpointBalancer.h"
+#include "RequestEngine.h"
+#include "UiDispatcher.h"
+#include "Utf8Convert.h"
 #include "menuCmdID.h"
 
 // For file + cURL + JSON ops
+#include <climits> // INT_MAX
 #include <wchar.h>
 #include <shlwapi.h>
 #include <curl/curl.h>
-#include <codecvt> // codecvt_utf8
-#include <locale>  // wstring_convert
 #include <nlohmann/json.hpp>
 #include <regex>
 
-// For "async" cURL calls
-#include <thread>
+// For chat contexts
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
 
 // Instead of `#include <commctrl.h>` we define the required constants only!
 #define UD_MAXVAL 0x7fff // 32767 (more than enough)
@@ -46,6 +54,7 @@ ChatSettingsDlg _chatSettingsDlg;
 // Config file related vars/constants
 TCHAR iniFilePath[MAX_PATH];
 TCHAR instructionsFilePath[MAX_PATH]; // Aka. file for Ollama system message
+TCHAR cacheFilePath[MAX_PATH];        // Answers kept across sessions, see `_diskCache`
 
 // The plugin data that Notepad++ needs
 FuncItem funcItem[nbFunc];
@@ -53,22 +62,37 @@ FuncItem funcItem[nbFunc];
 // The data of Notepad++ that you can use in your plugin commands
 NppData nppData;
 
-// Config file related vars
-std::wstring configAPIValue_secretKey        = TEXT("not-required-for-ollama"); // No API key needed for local Ollama
-std::wstring configAPIValue_baseURL          = TEXT("http://localhost:11434/"); // Default Ollama API endpoint
-std::wstring configAPIValue_proxyURL         = TEXT("0"); // 0: don't use proxy. Trailing '/' will be erased (if any)
-std::wstring configAPIValue_model            = TEXT("deekseek-r1:latest"); // Default Ollama model
-std::wstring configAPIValue_instructions     = TEXT(""); // System message ("instuctions") for the Ollama API e.g. "Translate the given text into English." or "Create a PHP function based on the received text.". Leave empty to skip.
-std::wstring configAPIValue_temperature      = TEXT("0.7");
-std::wstring configAPIValue_maxTokens        = TEXT("0"); // 0: Skip `max_tokens` API setting. Recommended max. value:  <4.000
-std::wstring configAPIValue_topP             = TEXT("0.8");
-std::wstring configAPIValue_frequencyPenalty = TEXT("0");
-std::wstring configAPIValue_presencePenalty  = TEXT("0");
+// Shared cURL state (pooled handles, keep-alive connections) + the thread driving all transfers
+CurlTransport _curlTransport;
+EndpointBalancer _endpointBalancer; // The `api_url` servers: requests to a path (e.g. "/api/chat") are spread over them
+RequestEngine _requestEngine(_curlTransport, _endpointBalancer);
+std::set<RequestId> askRequestIds; // The running "Ask Ollama" requests, see `cancelAskOllama()` (UI thread)
+
+// Runs the results + streamed fragments of the engine thread on the UI thread
+UiDispatcher _uiDispatcher;
+
+// Typed settings parsed by `reloadConfig()`: a request keeps the snapshot it started with
+ConfigStore _configStore;
+std::mutex configReloadMutex;
+FileWatcher _configWatcher; // Reloads the config after the config/instructions file is saved
+
+// Answers of the same requests (same model, options, instructions, question...)
+ResponseCache _responseCache;
+DiskCache _diskCache; // Looked up after `_responseCache`, on its own thread
+SemanticCache _semanticCache; // Answers of similar (not chat) questions, looked up after `_diskCache`
+
+// Config file related vars (the [API] defaults: `configDefault()`)
 bool isKeepQuestion                          = true;
-std::vector<std::wstring> chatHistory        = {};
+std::map<LRESULT, ChatSession> chatSessions;       // Chat history of each document (by buffer ID), sent to /api/chat
+std::mutex chatHistoryMutex;
 
-// Collect selected text by Scintilla here
-TCHAR selectedText[9999];
+// Running "Ask Ollama in chunks" job (cancelled by the loader dialog)
+std::shared_ptr<ChunkedJob> _chunkedJob;
+
+// Chat: Ollama `context` of each document (by buffer ID) -- updated on the UI thread (results are delivered by `_uiDispatcher`)
+std::map<LRESULT, ChatContext> chatContexts;
+ChatContextStats chatContextStats;
+std::mutex chatContextsMutex;
 
 //
 // Initialize your plugin data here
@@ -115,10 +139,36 @@ void commandMenuInit()
 	// Prepare config + instructions (aka. system message) file
 	PathCombine(iniFilePath, configDirPath, TEXT("NppOpenAI.ini"));
 	PathCombine(instructionsFilePath, configDirPath, TEXT("NppOpenAI_instructions"));
+	PathCombine(cacheFilePath, configDirPath, TEXT("NppOpenAI_cache"));
+
+	// Deliver the results of the engine thread to the UI thread
+	_uiDispatcher.create((HINSTANCE)_hModule);
+
+	// Init cURL once (NOT in `pluginInit()`: `DllMain` must not init winsock)
+	initCurlTransport();
 
 	// Load config file content
 	loadConfig(true);
 
+	// Apply the saved config/instructions file without Load Config (the [PLUGIN] section is only read at startup)
+	std::vector<FileWatcherPath> configFileNames = { PathFindFileName(iniFilePath), PathFindFileName(instructionsFilePath) };
+	// Invalid values are reported once per saved content (the watcher thread can't show a message box)
+	_configWatcher.start(configDirPath, configFileNames, std::chrono::milliseconds(300), []()
+	{
+		static uint64_t lastWarnedSourceHash = 0;
+		std::string configErrors;
+		bool isInstructionsFound;
+		if (reloadConfig(false, configErrors, isInstructionsFound) && !configErrors.empty())
+		{
+			uint64_t sourceHash = _configStore.get()->sourceHash;
+			if (sourceHash != lastWarnedSourceHash)
+			{
+				lastWarnedSourceHash = sourceHash;
+				_uiDispatcher.post([configErrors]() { configErrorsWarning(configErrors); });
+			}
+		}
+	});
+
 
     //--------------------------------------------//
     //-- STEP 3. CUSTOMIZE YOUR PLUGIN COMMANDS --//
@@ -140,15 +190,17 @@ void commandMenuInit()
 
 	// Plugin menu items
 	setCommand(0, TEXT("Ask &Ollama"), askChatGPT, askOllamaKey, false);
-	setCommand(1, TEXT("---"), NULL, NULL, false);
-	setCommand(2, TEXT("&Edit Config"), openConfig, NULL, false);
-	setCommand(3, TEXT("Edit &Instructions"), openInsturctions, NULL, false);
-	setCommand(4, TEXT("&Load Config"), loadConfigWithoutPluginSettings, NULL, false);
-	setCommand(5, TEXT("---"), NULL, NULL, false);
-	setCommand(6, TEXT("&Keep my question"), keepQuestionToggler, NULL, isKeepQuestion);
-	setCommand(7, TEXT("NppOllama &Chat Settings"), openChatSettingsDlg, NULL, false); // Text will be updated by `updateToolbarIcons()` » `updateChatSettings()`
-	setCommand(8, TEXT("---"), NULL, NULL, false);
-	setCommand(9, TEXT("&About"), openAboutDlg, NULL, false);
+	setCommand(1, TEXT("Ask Ollama in C&hunks (Large Selection or Whole Document)"), askOllamaInChunks, NULL, false);
+	setCommand(2, TEXT("---"), NULL, NULL, false);
+	setCommand(3, TEXT("&Edit Config"), openConfig, NULL, false);
+	setCommand(4, TEXT("Edit &Instructions"), openInsturctions, NULL, false);
+	setCommand(5, TEXT("&Load Config"), loadConfigWithoutPluginSettings, NULL, false);
+	setCommand(6, TEXT("---"), NULL, NULL, false);
+	setCommand(7, TEXT("&Keep my question"), keepQuestionToggler, NULL, isKeepQuestion);
+	setCommand(8, TEXT("NppOllama &Chat Settings"), openChatSettingsDlg, NULL, false); // Text will be updated by `updateToolbarIcons()` » `updateChatSettings()`
+	setCommand(9, TEXT("---"), NULL, NULL, false);
+	setCommand(10, TEXT("Show &Statistics"), openStatsDlg, NULL, false);
+	setCommand(11, TEXT("&About"), openAboutDlg, NULL, false);
 }
 
 // Add/update toolbar icons
@@ -173,7 +225,7 @@ void updateToolbarIcons()
 	chatSettingsIcons.hToolbarBmp = ::LoadBitmap((HINSTANCE)_hModule, MAKEINTRESOURCE(hToolbarBmp));
 	chatSettingsIcons.hToolbarIcon = ::LoadIcon((HINSTANCE)_hModule, MAKEINTRESOURCE(hToolbarIcon));
 	chatSettingsIcons.hToolbarIconDarkMode = ::LoadIcon((HINSTANCE)_hModule, MAKEINTRESOURCE(hToolbarIconDarkMode));
-	::SendMessage(nppData._nppHandle, NPPM_ADDTOOLBARICON_FORDARKMODE, funcItem[7]._cmdID, (LPARAM)&chatSettingsIcons); // Open Chat Settings
+	::SendMessage(nppData._nppHandle, NPPM_ADDTOOLBARICON_FORDARKMODE, funcItem[8]._cmdID, (LPARAM)&chatSettingsIcons); // Open Chat Settings
 	updateChatSettings();
 }
 
@@ -184,8 +236,20 @@ void commandMenuCleanUp()
 {
 	// Don't forget to deallocate your shortcut here
 	delete funcItem[0]._pShKey;
+	_configWatcher.stop(); // Before the engine + caches it reconfigures
+	bool isEngineStopped = _requestEngine.stop(); // Before destroying the dialogs used by the callbacks; aborts the running transfers, waits max. 2 s
+	_diskCache.close();    // Writes the answers still queued
+	_uiDispatcher.destroy(); // Drop the results not delivered yet
 	_loaderDlg.destroy();
 	_chatSettingsDlg.destroy();
+	if (isEngineStopped)
+	{
+		_curlTransport.cleanup();
+	}
+	else
+	{
+		_curlTransport.abandon(); // The engine thread was left in a callback: it may still be in cURL
+	}
 }
 
 
@@ -218,6 +282,12 @@ void loadConfigWithoutPluginSettings() {
 	loadConfig(false);
 }
 
+// Write the default of an [API] value to the config file
+static void writeConfigDefault(const char* key)
+{
+	::WritePrivateProfileString(TEXT("API"), utf8ToWide(key).c_str(), utf8ToWide(configDefault(key)).c_str(), iniFilePath);
+}
+
 // Load (and create if not found) config file
 void loadConfig(bool loadPluginSettings)
 {
@@ -232,23 +302,32 @@ void loadConfig(bool loadPluginSettings)
 		::WritePrivateProfileString(TEXT("INFO"), TEXT("; == You don't need an API key for Ollama running on localhost ="), TEXT(""), iniFilePath);
 		::WritePrivateProfileString(TEXT("INFO"), TEXT("; == Token and pricing info: Ollama is free and runs locally ="), TEXT(""), iniFilePath);
 		::WritePrivateProfileString(TEXT("INFO"), TEXT("; == Set `max_tokens=0` to skip this setting. ="), TEXT(""), iniFilePath);
-		::WritePrivateProfileString(TEXT("API"), TEXT("secret_key"), configAPIValue_secretKey.c_str(), iniFilePath);
-		::WritePrivateProfileString(TEXT("API"), TEXT("model"), configAPIValue_model.c_str(), iniFilePath);
-		::WritePrivateProfileString(TEXT("API"), TEXT("temperature"), configAPIValue_temperature.c_str(), iniFilePath);
-		::WritePrivateProfileString(TEXT("API"), TEXT("max_tokens"), configAPIValue_maxTokens.c_str(), iniFilePath);
-		::WritePrivateProfileString(TEXT("API"), TEXT("top_p"), configAPIValue_topP.c_str(), iniFilePath);
-		::WritePrivateProfileString(TEXT("API"), TEXT("frequency_penalty"), configAPIValue_frequencyPenalty.c_str(), iniFilePath);
-		::WritePrivateProfileString(TEXT("API"), TEXT("presence_penalty"), configAPIValue_presencePenalty.c_str(), iniFilePath);
+		writeConfigDefault("secret_key");
+		writeConfigDefault("model");
+		writeConfigDefault("temperature");
+		writeConfigDefault("max_tokens");
+		writeConfigDefault("top_p");
+		writeConfigDefault("frequency_penalty");
+		writeConfigDefault("presence_penalty");
 		::WritePrivateProfileString(TEXT("PLUGIN"), TEXT("keep_question"), TEXT("1"), iniFilePath);
 		::WritePrivateProfileString(TEXT("PLUGIN"), TEXT("total_tokens_used"), TEXT("0"), iniFilePath);
 	}
+	else if (std::wstring(tbuffer2) == TEXT("gpt-4"))
+	{
+		writeConfigDefault("model");
+	}
 
 	// Set up the default API URL
 	if (::GetPrivateProfileString(TEXT("API"), TEXT("api_url"), NULL, tbuffer2, 256, iniFilePath) == NULL)
 	{
-		::WritePrivateProfileString(TEXT("API"), TEXT("api_url"), configAPIValue_baseURL.c_str(), iniFilePath);
+		writeConfigDefault("api_url");
 		::WritePrivateProfileString(TEXT("INFO"), TEXT("; == The endpoint for Ollama is /api/generate. If you're running Ollama on a different port, change the URL. ="), TEXT(""), iniFilePath);
 	}
+	if (::GetPrivateProfileString(TEXT("API"), TEXT("pin_chat"), NULL, tbuffer2, 2, iniFilePath) == NULL)
+	{
+		writeConfigDefault("pin_chat");
+		::WritePrivateProfileString(TEXT("INFO"), TEXT("; == More Ollama servers: list them in `api_url` separated by ',' (e.g. 'http://box1:11434,http://box2:11434'), each request goes to the less busy/faster one. `pin_chat=1` keeps a chat on one server. Raise `parallel_requests` too. ="), TEXT(""), iniFilePath);
+	}
 
 	// Chat preparations + create file for instructions (aka. system message)
 	if (::GetPrivateProfileString(TEXT("PLUGIN"), TEXT("is_chat"), NULL, tbuffer2, 2, iniFilePath) == NULL)
@@ -274,58 +353,73 @@ void loadConfig(bool loadPluginSettings)
 	// Set up proxy settings
 	if (::GetPrivateProfileString(TEXT("API"), TEXT("proxy_url"), NULL, tbuffer2, 256, iniFilePath) == NULL)
 	{
-		::WritePrivateProfileString(TEXT("API"), TEXT("proxy_url"), configAPIValue_proxyURL.c_str(), iniFilePath);
+		writeConfigDefault("proxy_url");
 		::WritePrivateProfileString(TEXT("INFO"), TEXT("; == Enter a `proxy_url` to use proxy like 'http://127.0.0.1:80'. Optional, enter 0 (zero) to skip. ="), TEXT(""), iniFilePath);
 	}
 
-	// Get instructions (aka. system message) file
-	if ((instructionsFile = _wfopen(instructionsFilePath, L"r, ccs=UNICODE")) != NULL)
+	// Set up streaming (insert the response while it's generated)
+	if (::GetPrivateProfileString(TEXT("API"), TEXT("stream"), NULL, tbuffer2, 2, iniFilePath) == NULL)
 	{
-		wchar_t instructionsBuffer[9999];
-		configAPIValue_instructions = TEXT("");
-		while (fgetws(instructionsBuffer, 9999, instructionsFile))
-		{
-			configAPIValue_instructions += instructionsBuffer;
-		}
-		fclose(instructionsFile);
+		writeConfigDefault("stream");
+		::WritePrivateProfileString(TEXT("INFO"), TEXT("; == Set `stream=1` to see the response while Ollama generates it, or `stream=0` to insert it at once. ="), TEXT(""), iniFilePath);
 	}
-	else
+
+	// Set up the request limit
+	if (::GetPrivateProfileString(TEXT("API"), TEXT("parallel_requests"), NULL, tbuffer2, 4, iniFilePath) == NULL)
 	{
-		instructionsFileError(TEXT("The instructions (system message) file was not found:\n\n"), TEXT("NppOllama: missing instructions file"));
+		writeConfigDefault("parallel_requests");
+		::WritePrivateProfileString(TEXT("INFO"), TEXT("; == `parallel_requests` is the max. number of requests sent to Ollama at the same time, should match OLLAMA_NUM_PARALLEL. ="), TEXT(""), iniFilePath);
 	}
 
-	// Get API config/settings
-	::GetPrivateProfileString(TEXT("API"), TEXT("secret_key"), NULL, tbuffer2, 256, iniFilePath);
-	configAPIValue_secretKey = std::wstring(tbuffer2);
-
-	::GetPrivateProfileString(TEXT("API"), TEXT("api_url"), NULL, tbuffer2, 256, iniFilePath);
-	configAPIValue_baseURL = std::wstring(tbuffer2);
-
-	::GetPrivateProfileString(TEXT("API"), TEXT("proxy_url"), NULL, tbuffer2, 256, iniFilePath);
-	configAPIValue_proxyURL = std::wstring(tbuffer2);
-
-	::GetPrivateProfileString(TEXT("API"), TEXT("model"), NULL, tbuffer2, 128, iniFilePath);
-	if (std::wstring(tbuffer2) == TEXT("gpt-4"))
+	// Set up chat API settings
+	if (::GetPrivateProfileString(TEXT("API"), TEXT("chat_api"), NULL, tbuffer2, 2, iniFilePath) == NULL)
 	{
-		::WritePrivateProfileString(TEXT("API"), TEXT("model"), configAPIValue_model.c_str(), iniFilePath);
-		::GetPrivateProfileString(TEXT("API"), TEXT("model"), NULL, tbuffer2, 128, iniFilePath);
+		writeConfigDefault("chat_api");
+		writeConfigDefault("num_ctx");
+		::WritePrivateProfileString(TEXT("INFO"), TEXT("; == Chat mode: `chat_api=1` sends the chat history to /api/chat (trimmed to fit `num_ctx` tokens), `chat_api=0` continues from the previous /api/generate `context`. ="), TEXT(""), iniFilePath);
 	}
-	configAPIValue_model = std::wstring(tbuffer2);
-
-	::GetPrivateProfileString(TEXT("API"), TEXT("temperature"), NULL, tbuffer2, 16, iniFilePath);
-	configAPIValue_temperature = std::wstring(tbuffer2);
-
-	::GetPrivateProfileString(TEXT("API"), TEXT("max_tokens"), NULL, tbuffer2, 5, iniFilePath);
-	configAPIValue_maxTokens = std::wstring(tbuffer2);
 
-	::GetPrivateProfileString(TEXT("API"), TEXT("top_p"), NULL, tbuffer2, 5, iniFilePath);
-	configAPIValue_topP = std::wstring(tbuffer2);
+	// Set up "Ask Ollama in chunks"
+	if (::GetPrivateProfileString(TEXT("API"), TEXT("chunk_size"), NULL, tbuffer2, 10, iniFilePath) == NULL)
+	{
+		writeConfigDefault("chunk_size");
+		writeConfigDefault("chunk_overlap");
+		writeConfigDefault("reduce_prompt");
+		::WritePrivateProfileString(TEXT("INFO"), TEXT("; == Ask in chunks: the text is sent in `chunk_size` byte parts (`parallel_requests` at once), the answers are joined in order. Enter a `reduce_prompt` (e.g. 'Summarize these summaries:') to combine them with one more request. ="), TEXT(""), iniFilePath);
+	}
 
-	::GetPrivateProfileString(TEXT("API"), TEXT("frequency_penalty"), NULL, tbuffer2, 5, iniFilePath);
-	configAPIValue_frequencyPenalty = std::wstring(tbuffer2);
+	// Set up the response cache
+	if (::GetPrivateProfileString(TEXT("API"), TEXT("cache_size"), NULL, tbuffer2, 8, iniFilePath) == NULL)
+	{
+		writeConfigDefault("cache_size");
+		writeConfigDefault("cache_random");
+		::WritePrivateProfileString(TEXT("INFO"), TEXT("; == Answers of repeated questions are reused from a `cache_size` MB cache (0: disabled). Only if `temperature=0`, unless `cache_random=1`. ="), TEXT(""), iniFilePath);
+	}
+	if (::GetPrivateProfileString(TEXT("API"), TEXT("disk_cache_size"), NULL, tbuffer2, 8, iniFilePath) == NULL)
+	{
+		writeConfigDefault("disk_cache_size");
+		::WritePrivateProfileString(TEXT("INFO"), TEXT("; == Cached answers are also kept in the `NppOpenAI_cache` file (max. `disk_cache_size` MB, 0: disabled) for the next sessions. ="), TEXT(""), iniFilePath);
+	}
+	if (::GetPrivateProfileString(TEXT("API"), TEXT("semantic_threshold"), NULL, tbuffer2, 8, iniFilePath) == NULL)
+	{
+		writeConfigDefault("semantic_threshold");
+		writeConfigDefault("semantic_cache_size");
+		writeConfigDefault("embed_model");
+		::WritePrivateProfileString(TEXT("INFO"), TEXT("; == Similar questions (not in chat mode): set `semantic_threshold=0.95` to reuse the answer of a question whose `embed_model` embedding is at least this similar (cosine). Pull the model first, e.g. `ollama pull all-minilm`. ="), TEXT(""), iniFilePath);
+	}
 
-	::GetPrivateProfileString(TEXT("API"), TEXT("presence_penalty"), NULL, tbuffer2, 5, iniFilePath);
-	configAPIValue_presencePenalty = std::wstring(tbuffer2);
+	// Get API config/settings + instructions (aka. system message): one read per file, parsed into a new `Config` (also done by `_configWatcher`)
+	std::string configErrors;
+	bool isInstructionsFound = false;
+	reloadConfig(true, configErrors, isInstructionsFound);
+	if (!isInstructionsFound)
+	{
+		instructionsFileError(TEXT("The instructions (system message) file was not found:\n\n"), TEXT("NppOllama: missing instructions file"));
+	}
+	if (!configErrors.empty())
+	{
+		configErrorsWarning(configErrors);
+	}
 
 	// Get Plugin config/settings
 	// Do NOT load "PLUGIN" section when clicking the Load Config menu item (may cause misconfiguration)
@@ -341,7 +435,7 @@ void loadConfig(bool loadPluginSettings)
 				: tmpChatLimit);
 
 		// Update chat menu item text (if already initialized)
-		if (funcItem[7]._pFunc)
+		if (funcItem[8]._pFunc)
 		{
 			updateChatSettings();
 		}
@@ -359,119 +453,139 @@ void askChatGPT()
 	// Get current selection
 	size_t selstart  = ::SendMessage(curScintilla, SCI_GETSELECTIONSTART, 0, 0);
 	size_t selend    = ::SendMessage(curScintilla, SCI_GETSELECTIONEND, 0, 0);
-	size_t sellength = selend - selstart;
 
 	// Check if everything is fine
 	bool isEditable  = !(int)::SendMessage(curScintilla, SCI_GETREADONLY, 0, 0);
-	if (isEditable
-		&& selend > selstart
-		&& sellength < 2048
-		&& ::SendMessage(nppData._nppHandle, NPPM_GETCURRENTWORD, 2048, (LPARAM)selectedText)
-		)
-	{
-		// Data to post via cURL - Ollama format
-		json postData = {
-			{"model", toUTF8(configAPIValue_model)},
-			{"temperature", std::stod(configAPIValue_temperature)},
-			{"top_p", std::stod(configAPIValue_topP)}
-		};
-
-		// Add `max_tokens` setting if specified
-		if (std::stoi(configAPIValue_maxTokens) > 0)
+	if (isEditable && selend > selstart)
+	{
+		// Read the selection as UTF-8, no length limit
+		std::string selectedText = getSelectedText(curScintilla, selstart, selend);
+
+		// The config of this request, even if Load Config is clicked meanwhile
+		std::shared_ptr<const Config> config = _configStore.get();
+
+		// Ollama streams by default, so always tell which mode we want
+		bool isStream = config->isStream;
+
+		// Data to post via cURL - Ollama format: the question spliced into the body precompiled by `loadConfig()`
+		const RequestTemplate& requestTemplate = config->requestTemplate;
+		const RequestTemplate::Settings& requestSettings = requestTemplate.settings();
+		LRESULT bufferID = ::SendMessage(nppData._nppHandle, NPPM_GETCURRENTBUFFERID, 0, 0);
+		bool isChat = _chatSettingsDlg.chatSetting_isChat;
+		bool isChatAPI = isChat && config->isChatAPI;
+		bool isFollowUp = false;
+		std::string JSONRequest;
+		if (isChatAPI)
 		{
-			postData[toUTF8(TEXT("max_tokens"))] = std::stoi(configAPIValue_maxTokens);
+			// Chat via /api/chat: system message, history (oldest first), question -- `num_ctx` is also the budget of the chat history
+			// (invalid UTF-8 in the selection is replaced, not thrown)
+			json messages = buildChatMessages(bufferID, requestSettings.instructions, selectedText, requestSettings.contextLength, requestSettings.maxTokens, isFollowUp);
+			JSONRequest = requestTemplate.chatBody(messages.dump(-1, ' ', false, json::error_handler_t::replace), isStream);
 		}
-
-		// Add system instructions if available
-		if (!configAPIValue_instructions.empty())
+		else
 		{
-			postData["system"] = toUTF8(configAPIValue_instructions);
-		}
+			// Chat via /api/generate: continue the conversation of this document from Ollama's cached state (`context`) instead of re-sending it
+			std::vector<int> context;
+			if (isChat)
+			{
+				std::lock_guard<std::mutex> lock(chatContextsMutex);
+				auto chatContext = chatContexts.find(bufferID);
+				if (chatContext != chatContexts.end())
+				{
+					if (chatContext->second.turns >= _chatSettingsDlg.chatSetting_chatLimit)
+					{
+						chatContexts.erase(chatContext); // Chat limit reached: start a new conversation
+					}
+					else if (!chatContext->second.context.empty())
+					{
+						context = chatContext->second.context;
+						isFollowUp = true;
+					}
+				}
+			}
 
-		// Add the main prompt
-		postData["prompt"] = toUTF8(selectedText);
+			// System instructions (if available) + the main prompt
+			JSONRequest = requestTemplate.generateBody(selectedText, &context, isStream);
+		}
 		
 		// Update URLs for API call
 		bool isReady2CallOllama = true;
-		std::string OpenAIURL = toUTF8(configAPIValue_baseURL).erase(toUTF8(configAPIValue_baseURL).find_last_not_of("/") + 1);
-		std::string ProxyURL = toUTF8(configAPIValue_proxyURL).erase(toUTF8(configAPIValue_proxyURL).find_last_not_of("/") + 1);
+		std::string ProxyURL = config->proxyURL;
 		
-		// Set the Ollama API endpoint
-		OpenAIURL += "/api/generate";
+		// Set the Ollama API endpoint (the server is chosen by `_endpointBalancer` when the request starts)
+		std::string OpenAIURL = isChatAPI ? "/api/chat" : "/api/generate";
 
 		// Ready to call Ollama
 		if (isReady2CallOllama)
 		{
-			// Create/Show a loader dialog ("Please wait..."), disable main window
-			_loaderDlg.doDialog();
-			::EnableWindow(nppData._nppHandle, FALSE);
-
-			// Prepare to start a new thread
-			auto curlLambda = [](std::string OpenAIURL, std::string ProxyURL, json postData, HWND curScintilla)
+			// Prepare the request state, shared by the cURL callbacks
+			std::shared_ptr<AskOllamaRequest> askRequest = std::make_shared<AskOllamaRequest>();
+			askRequest->sink.attach(nppData, curScintilla, (UINT_PTR)bufferID, selstart, selend, !isKeepQuestion);
+			askRequest->config = config;
+			askRequest->bufferID = bufferID;
+			askRequest->isChat = isChat;
+			askRequest->isFollowUp = isFollowUp;
+			askRequest->isStream = isStream;
+			askRequest->question = std::move(selectedText);
+			if (isStream)
 			{
-				std::string JSONRequest = postData.dump();
-
-				// Try to call Ollama and store the results in `JSONBuffer`
-				std::string JSONBuffer;
-				bool isSuccessCall = callOpenAI(OpenAIURL, ProxyURL, JSONRequest, JSONBuffer);
-
-				// Hide loader dialog, enable main window
-				_loaderDlg.display(false);
-				::EnableWindow(nppData._nppHandle, TRUE);
-				::SetForegroundWindow(nppData._nppHandle);
+				AskOllamaRequest* askRequestPtr = askRequest.get(); // The request owns its stream: no `shared_ptr` here (avoid a reference cycle)
+				askRequest->stream.reset(new OllamaStream([askRequestPtr](const OllamaChunk& chunk)
+				{
+					onOllamaChunk(*askRequestPtr, chunk);
+				}));
+			}
 
-				// Return if something went wrong
-				if (!isSuccessCall)
+			// Same request answered before: no need to ask Ollama again
+			if (_responseCache.isEnabled())
+			{
+				if (requestSettings.temperature > 0 && !config->isCacheRandom)
 				{
-					return;
+					_responseCache.countBypassed();
 				}
-
-				// Parse response
-				try
+				else
 				{
-					json JSONResponse = json::parse(JSONBuffer);
-
-					// Handle Ollama response format
-					if (JSONResponse.contains("response"))
+					askRequest->cacheKey = config->baseURL + OpenAIURL + "\n" + JSONRequest;
+					if (!isChat && _semanticCache.isEnabled())
 					{
-						// Get the response text
-						std::string responseText;
-						JSONResponse["response"].get_to(responseText);
-
-						// Replace selected text with response in the main Notepad++ window
-						replaceSelected(curScintilla, responseText);
-
-						// Update chat history
-						chatHistory.push_back(selectedText);
-						chatHistory.push_back(std::wstring(responseText.begin(), responseText.end()));
-
-						// No need to update token counts for Ollama as it doesn't track them
+						// Similar questions are compared within the same model, options and system text
+						std::string scope = config->baseURL + OpenAIURL + "\n" + requestTemplate.generateBody(std::string(), nullptr, isStream);
+						askRequest->semanticScope = hashBytes(scope.data(), scope.size());
+						askRequest->isSemanticCached = true;
 					}
-					else if (JSONResponse.contains("error"))
+					CachedResponse cachedResponse;
+					if (_responseCache.get(askRequest->cacheKey, cachedResponse))
 					{
-						std::string errorResponse;
-						TCHAR errorResponseWide[512] = { 0, };
-						JSONResponse["error"].get_to(errorResponse);
-						std::copy(errorResponse.begin(), errorResponse.end(), errorResponseWide);
-						::MessageBox(nppData._nppHandle, errorResponseWide, TEXT("Ollama: Error response"), MB_ICONEXCLAMATION);
+						applyCachedResponse(*askRequest, cachedResponse);
+						return;
 					}
-					else
+
+					// Answered in an earlier session? Looked up on the cache thread, Ollama is called after a miss
+					if (_diskCache.isEnabled())
 					{
-						::MessageBox(nppData._nppHandle, TEXT("Missing 'response' in JSON response!"), TEXT("Ollama: Invalid answer"), MB_ICONEXCLAMATION);
+						_diskCache.get(askRequest->cacheKey, [askRequest, OpenAIURL, ProxyURL, JSONRequest](bool isFound, const CachedResponse& cachedResponse)
+						{
+							_uiDispatcher.post([askRequest, OpenAIURL, ProxyURL, JSONRequest, isFound, cachedResponse]()
+							{
+								if (isFound)
+								{
+									_responseCache.put(askRequest->cacheKey, cachedResponse);
+									applyCachedResponse(*askRequest, cachedResponse);
+								}
+								else
+								{
+									askSemanticCache(askRequest, OpenAIURL, ProxyURL, JSONRequest);
+								}
+							});
+						});
+						return;
 					}
+					askSemanticCache(askRequest, OpenAIURL, ProxyURL, JSONRequest);
+					return;
 				}
-				catch (json::parse_error& ex)
-				{
-					std::string responseException = ex.what();
-					std::string responseText = JSONBuffer.c_str();
-					responseText += "\n\n" + responseException;
-					replaceSelected(curScintilla, responseText);
-					::MessageBox(nppData._nppHandle, TEXT("Invalid or non-JSON response!\n\nSee details in the main window"), TEXT("Ollama: Invalid response"), MB_ICONERROR);
-				}
-			};
+			}
 
-			std::thread curlThread(curlLambda, OpenAIURL, ProxyURL, postData, curScintilla);
-			curlThread.detach();
+			sendOllamaRequest(askRequest, OpenAIURL, ProxyURL, JSONRequest);
 		}
 	}
 	else if (!isEditable)
@@ -482,75 +596,716 @@ void askChatGPT()
 	{
 		::MessageBox(nppData._nppHandle, TEXT("Please select a text first"), TEXT("Ollama: Missing question"), MB_ICONWARNING);
 	}
-	else if (sellength >= 2048)
+}
+
+// Read the config + instructions files (one read each) into a new `Config`, publish + apply it; unchanged values are skipped unless `isForced`.
+// Any thread (UI: Load Config, watcher thread: `_configWatcher`), errors are returned, not shown.
+bool reloadConfig(bool isForced, std::string& configErrors, bool& isInstructionsFound)
+{
+	std::lock_guard<std::mutex> lock(configReloadMutex);
+	std::string iniText;
+	std::string instructions;
+	readConfigText(iniFilePath, iniText);
+	isInstructionsFound = readConfigText(instructionsFilePath, instructions);
+	std::shared_ptr<Config> config = parseConfig(parseIniSection(iniText, "API"), instructions, configErrors);
+	if (!isForced && config->sourceHash == _configStore.get()->sourceHash)
+	{
+		return false; // E.g. only the [PLUGIN] section was written
+	}
+
+	// Running requests keep their snapshot
+	_configStore.set(config);
+	_endpointBalancer.setEndpoints(config->baseURLs);
+	_requestEngine.setMaxInFlight((size_t)config->parallelRequests);
+	_responseCache.setMaxBytes(config->cacheBytes);
+	_diskCache.open(cacheFilePath, config->cacheBytes > 0 ? config->diskCacheBytes : 0); // Opened in the background
+	_semanticCache.setMaxEntries((config->semanticThreshold > 0 && config->cacheBytes > 0) ? config->semanticCacheSize : 0);
+	return true;
+}
+
+// Invalid values of the config file (UTF-8 list of `parseConfig()`): the defaults are used instead (UI thread)
+void configErrorsWarning(const std::string& configErrors)
+{
+	std::wstring errorText = TEXT("Invalid values in the config file, the defaults are used instead:\n\n") + utf8ToWide(configErrors);
+	::MessageBox(nppData._nppHandle, errorText.c_str(), TEXT("NppOllama: Invalid config"), MB_ICONWARNING);
+}
+
+// Get the selected text as UTF-8
+std::string getSelectedText(HWND curScintilla, size_t selstart, size_t selend)
+{
+	// Single selection: copy straight from Scintilla's buffer
+	if (::SendMessage(curScintilla, SCI_GETSELECTIONS, 0, 0) <= 1
+		&& !::SendMessage(curScintilla, SCI_SELECTIONISRECTANGLE, 0, 0))
 	{
-		::MessageBox(nppData._nppHandle, TEXT("The selected text is too long. Please select a text shorter than 2048 characters"), TEXT("Ollama: Invalid question"), MB_ICONWARNING);
+		std::string selectedText = getTextRange(curScintilla, selstart, selend);
+		if (!selectedText.empty())
+		{
+			return selectedText;
+		}
+	}
+
+	// Multiple/rectangular selections: let Scintilla join them
+	std::string selectedText;
+	size_t length = (size_t)::SendMessage(curScintilla, SCI_GETSELTEXT, 0, 0);
+	selectedText.resize(length + 1);
+	::SendMessage(curScintilla, SCI_GETSELTEXT, 0, (LPARAM)&selectedText[0]);
+	selectedText.resize(strlen(selectedText.c_str()));
+	return toUTF8FromDocument(curScintilla, selectedText);
+}
+
+// Get a part of the document as UTF-8 (no NUL-terminated temporary, no UTF-16 round trip)
+std::string getTextRange(HWND curScintilla, size_t start, size_t end)
+{
+	std::string text;
+	const char* rangePointer = (const char*)::SendMessage(curScintilla, SCI_GETRANGEPOINTER, start, end - start);
+	if (rangePointer)
+	{
+		text.assign(rangePointer, end - start);
+	}
+	return toUTF8FromDocument(curScintilla, text);
+}
+
+// ANSI documents: convert the text to UTF-8 (UTF-8 documents: keep it as is)
+std::string toUTF8FromDocument(HWND curScintilla, const std::string& text)
+{
+	if (::SendMessage(curScintilla, SCI_GETCODEPAGE, 0, 0) == SC_CP_UTF8 || text.empty())
+	{
+		return text;
+	}
+	int length = ::MultiByteToWideChar(CP_ACP, 0, text.c_str(), (int)text.length(), NULL, 0);
+	std::wstring wideText(length, L'\0');
+	::MultiByteToWideChar(CP_ACP, 0, text.c_str(), (int)text.length(), &wideText[0], length);
+	return wideToUtf8(wideText);
+}
+
+// Ask Ollama about a large selection (or the whole document if nothing is selected) in overlapping chunks,
+// then insert the joined answers (or the answer of the reduce pass) after the text
+void askOllamaInChunks()
+{
+	// Get current Scintilla
+	long currentEdit;
+	::SendMessage(nppData._nppHandle, NPPM_GETCURRENTSCINTILLA, 0, (LPARAM)&currentEdit);
+	HWND curScintilla = (currentEdit == 0) ? nppData._scintillaMainHandle : nppData._scintillaSecondHandle;
+
+	bool isEditable = !(int)::SendMessage(curScintilla, SCI_GETREADONLY, 0, 0);
+	if (!isEditable)
+	{
+		::MessageBox(nppData._nppHandle, TEXT("This file is not editable"), TEXT("Ollama: Invalid file"), MB_ICONERROR);
+		return;
+	}
+	if (std::atomic_load(&_chunkedJob))
+	{
+		return; // Already running
+	}
+
+	// Get the selection or the whole document
+	size_t selstart = ::SendMessage(curScintilla, SCI_GETSELECTIONSTART, 0, 0);
+	size_t selend   = ::SendMessage(curScintilla, SCI_GETSELECTIONEND, 0, 0);
+	std::string text;
+	if (selend > selstart)
+	{
+		text = getSelectedText(curScintilla, selstart, selend);
 	}
 	else
 	{
-		::MessageBox(nppData._nppHandle, TEXT("Please try to select a question first"), TEXT("Ollama: Unknown error"), MB_ICONERROR);
+		selstart = 0;
+		selend = ::SendMessage(curScintilla, SCI_GETLENGTH, 0, 0);
+		text = getTextRange(curScintilla, 0, selend);
+	}
+	if (text.empty())
+	{
+		::MessageBox(nppData._nppHandle, TEXT("The document is empty"), TEXT("Ollama: Missing question"), MB_ICONWARNING);
+		return;
 	}
+
+	// Split the text, one prompt per chunk
+	std::shared_ptr<const Config> config = _configStore.get();
+	std::vector<TextChunk> chunks = splitTextIntoChunks(text, config->chunkSize, config->chunkOverlap);
+	std::vector<std::string> prompts;
+	for (const TextChunk& chunk : chunks)
+	{
+		prompts.push_back(text.substr(chunk.begin, chunk.end - chunk.begin));
+	}
+
+	// Every chunk is a separate `/api/generate` request (no chat, no streaming); the job keeps its config snapshot: chunks are also sent from the engine thread
+	std::string OpenAIURL = "/api/generate";
+	std::string ProxyURL = config->proxyURL;
+
+	ChunkedJob::Backend backend = [config, OpenAIURL, ProxyURL](const std::string& prompt, ChunkedJob::AnswerHandler onAnswer)
+	{
+		std::shared_ptr<std::string> JSONBuffer = std::make_shared<std::string>();
+		return callOpenAI(OpenAIURL, ProxyURL, config->requestTemplate.generateBody(prompt, nullptr, false),
+			[JSONBuffer](const char* data, size_t length) { JSONBuffer->append(data, length); },
+			[JSONBuffer, onAnswer](const RequestResult& result)
+			{
+				if (!result.isOK())
+				{
+					onAnswer(false, result.isCancelled ? "" : result.errorText);
+					return;
+				}
+				OllamaChunk answer;
+				if (!parseOllamaChunk(JSONBuffer->c_str(), JSONBuffer->length(), answer))
+				{
+					onAnswer(false, "Invalid or non-JSON response: " + JSONBuffer->substr(0, 511));
+				}
+				else if (!answer.error.empty())
+				{
+					onAnswer(false, answer.error);
+				}
+				else
+				{
+					onAnswer(true, answer.response);
+				}
+			},
+			RequestPriority::Background, [JSONBuffer]() { JSONBuffer->clear(); }); // Preempted by "Ask Ollama": sent again later
+	};
+
+	// Insert the result after the text, wherever the user's edits moved it (UI thread)
+	std::shared_ptr<ScintillaSink> sink = std::make_shared<ScintillaSink>();
+	sink->attach(nppData, curScintilla, (UINT_PTR)::SendMessage(nppData._nppHandle, NPPM_GETCURRENTBUFFERID, 0, 0), selstart, selend, false);
+	ChunkedJob::FinishHandler onFinish = [sink](const ChunkedJobResult& result)
+	{
+		_uiDispatcher.post([sink, result]() { onChunkedJobFinished(*sink, result); });
+	};
+
+	// Create/Show a loader dialog ("Please wait..."), the editor stays usable
+	_loaderDlg.doDialog();
+
+	// Send `parallel_requests` chunks at once (Ollama's parallel slots)
+	std::shared_ptr<ChunkedJob> chunkedJob = std::make_shared<ChunkedJob>(std::move(prompts), (size_t)config->parallelRequests, config->reducePrompt,
+		backend, [](ChunkedJob::BackendRequestId requestId) { _requestEngine.cancel(requestId); }, onFinish);
+	std::atomic_store(&_chunkedJob, chunkedJob);
+	chunkedJob->start();
 }
 
-// Call Ollama via cURL
-bool callOpenAI(std::string OpenAIURL, std::string ProxyURL, std::string JSONRequest, std::string& JSONResponse)
+// Insert the result of "Ask Ollama in chunks" / show the error (UI thread)
+void onChunkedJobFinished(ScintillaSink& sink, const ChunkedJobResult& result)
 {
-	// Prepare cURL
-	CURL* curl;
-	CURLcode res;
-	curl_global_init(CURL_GLOBAL_ALL); // In windows, this will init the winsock stuff
+	std::atomic_store(&_chunkedJob, std::shared_ptr<ChunkedJob>());
+	onAskRequestFinished(0);
+	if (result.isCancelled)
+	{
+		sink.finish();
+		return;
+	}
+	if (!result.isOK)
+	{
+		sink.finish();
+		std::wstring errorText = TEXT("Failed chunks: ") + std::to_wstring(result.failedCount) + TEXT(" of ") + std::to_wstring(result.chunkCount)
+			+ TEXT("\n\n") + utf8ToWide(result.errorText);
+		::MessageBox(nppData._nppHandle, errorText.c_str(), TEXT("Ollama: Error"), MB_ICONERROR);
+		return;
+	}
+	sink.write(result.text);
+	sink.finish();
+}
 
-	// Get a cURL handle
-	curl = curl_easy_init();
-	if (!curl)
+// Cancel the running request (Cancel button or Esc on the loader dialog)
+void cancelAskOllama()
+{
+	std::shared_ptr<ChunkedJob> chunkedJob = std::atomic_load(&_chunkedJob);
+	if (chunkedJob)
 	{
-		return false;
+		chunkedJob->cancel(); // Hides the loader when the running chunks are cancelled
 	}
 
-	// Get the CA bundle file for cURL
-	TCHAR CACertFilePath[MAX_PATH];
-	const TCHAR CACertFileName[] = TEXT("NppOpenAI\\cacert.pem");
-	::SendMessage(nppData._nppHandle, NPPM_GETPLUGINHOMEPATH, MAX_PATH, (LPARAM)CACertFilePath);
-	PathAppend(CACertFilePath, CACertFileName);
+	bool isCancelling = false;
+	for (RequestId requestId : askRequestIds)
+	{
+		isCancelling = _requestEngine.cancel(requestId) || isCancelling;
+	}
 
-	// Prepare cURL SetOpts
-	struct curl_slist* headerList = NULL;
-	headerList = curl_slist_append(headerList, "Content-Type: application/json");
-	char userAgent[255];
-	sprintf(userAgent, "NppOllama/%s", NPPOPENAI_VERSION);
+	// Already finished (or never started): make sure the loader is hidden
+	if (!chunkedJob && !isCancelling)
+	{
+		_loaderDlg.display(false);
+	}
+}
+
+// Show the loader + send the question via the engine thread (its result is delivered by `_uiDispatcher`) (UI thread)
+void sendOllamaRequest(std::shared_ptr<AskOllamaRequest> askRequest, const std::string& OpenAIURL, const std::string& ProxyURL, const std::string& JSONRequest)
+{
+	// Create/Show a loader dialog ("Please wait..."), the editor stays usable
+	_loaderDlg.doDialog();
+
+	RequestId requestId = callOpenAI(OpenAIURL, ProxyURL, JSONRequest,
+		[askRequest](const char* data, size_t length) { onOllamaData(*askRequest, data, length); },
+		[askRequest](const RequestResult& result) { onOllamaResponse(*askRequest, result); },
+		RequestPriority::Interactive, nullptr, (askRequest->isChat && askRequest->config->isChatPinned) ? (uint64_t)askRequest->bufferID : 0);
+	if (requestId != 0)
+	{
+		askRequestIds.insert(requestId);
+	}
+	else
+	{
+		askRequest->sink.finish();
+		onAskRequestFinished(0);
+		::MessageBox(nppData._nppHandle, _requestEngine.isRunning()
+			? TEXT("Too many questions are waiting for Ollama, please try again later")
+			: TEXT("The request engine is not running (cURL could not be initialized)"), TEXT("Ollama: Connection Error"), MB_ICONERROR);
+	}
+}
+
+// Embed the question (`/api/embed`) to look up the answer of a similar one, Ollama is asked after a miss (UI thread)
+void askSemanticCache(std::shared_ptr<AskOllamaRequest> askRequest, const std::string& OpenAIURL, const std::string& ProxyURL, const std::string& JSONRequest)
+{
+	if (!askRequest->isSemanticCached)
+	{
+		sendOllamaRequest(askRequest, OpenAIURL, ProxyURL, JSONRequest);
+		return;
+	}
+
+	// Create/Show a loader dialog ("Please wait..."), the embedding request can be cancelled too
+	_loaderDlg.doDialog();
+
+	json embedData = { {"model", askRequest->config->embedModel}, {"input", askRequest->question} };
+	std::string embedURL = "/api/embed";
+	std::shared_ptr<std::string> JSONBuffer = std::make_shared<std::string>();
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	RequestId embedRequestId = callOpenAI(embedURL, ProxyURL, embedData.dump(-1, ' ', false, json::error_handler_t::replace),
+		[JSONBuffer](const char* data, size_t length) { JSONBuffer->append(data, length); },
+		[askRequest, OpenAIURL, ProxyURL, JSONRequest, JSONBuffer, startTime](const RequestResult& result)
+		{
+			_uiDispatcher.post([askRequest, OpenAIURL, ProxyURL, JSONRequest, JSONBuffer, startTime, result]()
+			{
+				onEmbedResponse(askRequest, result, *JSONBuffer, startTime, OpenAIURL, ProxyURL, JSONRequest);
+			});
+		},
+		RequestPriority::Interactive);
+	if (embedRequestId == 0)
+	{
+		sendOllamaRequest(askRequest, OpenAIURL, ProxyURL, JSONRequest); // Reports the error
+		return;
+	}
+	askRequestIds.insert(embedRequestId);
+}
+
+// Answer from the closest cached question, or ask Ollama (and keep the embedding for its answer) (UI thread)
+void onEmbedResponse(std::shared_ptr<AskOllamaRequest> askRequest, const RequestResult& result, const std::string& JSONBuffer, std::chrono::steady_clock::time_point startTime,
+	const std::string& OpenAIURL, const std::string& ProxyURL, const std::string& JSONRequest)
+{
+	if (result.isCancelled)
+	{
+		askRequest->sink.finish();
+		onAskRequestFinished(result.id);
+		return;
+	}
+
+	// `{"embeddings": [[...]]}`; errors (e.g. the model is not pulled) are not reported: the question is just sent
+	std::vector<float> embedding;
+	if (result.isOK())
+	{
+		try
+		{
+			json JSONResponse = json::parse(JSONBuffer);
+			if (JSONResponse.contains("embeddings") && JSONResponse["embeddings"].is_array() && !JSONResponse["embeddings"].empty())
+			{
+				JSONResponse["embeddings"][0].get_to(embedding);
+			}
+		}
+		catch (json::exception&)
+		{
+			embedding.clear();
+		}
+	}
+
+	CachedResponse cachedResponse;
+	float similarity = 0.0f;
+	bool isFound = !embedding.empty()
+		&& _semanticCache.find(askRequest->semanticScope, embedding, askRequest->config->semanticThreshold, cachedResponse, similarity);
+	_semanticCache.countLookup(!embedding.empty(), (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count());
+	if (isFound)
+	{
+		applyCachedResponse(*askRequest, cachedResponse);
+	}
+	else
+	{
+		askRequest->embedding = std::move(embedding);
+		sendOllamaRequest(askRequest, OpenAIURL, ProxyURL, JSONRequest);
+	}
+	onAskRequestFinished(result.id); // After `sendOllamaRequest()`: the loader stays
+}
+
+// A request (0: the chunked job) is finished: hide the loader after the last one (UI thread)
+void onAskRequestFinished(RequestId requestId)
+{
+	askRequestIds.erase(requestId);
+	if (askRequestIds.empty() && !std::atomic_load(&_chunkedJob))
+	{
+		_loaderDlg.display(false);
+	}
+}
+
+// Call Ollama via cURL: queue the request for the engine thread, `onData` + `onComplete` will be called from there
+RequestId callOpenAI(std::string OpenAIURL, std::string ProxyURL, std::string JSONRequest, std::function<void(const char*, size_t)> onData, std::function<void(const RequestResult&)> onComplete,
+	RequestPriority priority, std::function<void()> onRequeue, uint64_t session)
+{
+	OllamaRequest request;
+	request.URL = OpenAIURL;
+	request.proxyURL = ProxyURL;
+	request.postFields = JSONRequest;
+	request.onData = onData;
+	request.onComplete = onComplete;
+	request.priority = priority;
+	request.onRequeue = onRequeue;
+	request.session = session;
+	return _requestEngine.submit(request);
+}
+
+// Collect the received data (engine thread)
+void onOllamaData(AskOllamaRequest& askRequest, const char* data, size_t length)
+{
+	if (askRequest.stream)
+	{
+		askRequest.stream->feed(data, length);
+	}
+	else
+	{
+		askRequest.JSONBuffer.append(data, length);
+	}
+}
+
+// Queue every streamed `response` fragment for the UI thread as soon as it arrives (engine thread)
+void onOllamaChunk(AskOllamaRequest& askRequest, const OllamaChunk& chunk)
+{
+	if (!chunk.error.empty())
+	{
+		askRequest.errorResponse = chunk.error;
+	}
+	else if (!chunk.response.empty())
+	{
+		queueAnswer(askRequest, chunk.response.data(), chunk.response.size());
+	}
+
+	if (chunk.done)
+	{
+		queueAnswer(askRequest, nullptr, 0);
+		askRequest.finalChunk = chunk;
+	}
+}
+
+// Pass the complete code points of a fragment to `flushAnswer()`, `data` == nullptr: end of the answer (engine thread)
+void queueAnswer(AskOllamaRequest& askRequest, const char* data, size_t length)
+{
+	// One flush per frame, however many tokens arrive meanwhile
+	bool isFlushPosted;
+	{
+		std::lock_guard<std::mutex> lock(askRequest.pendingMutex);
+		size_t pendingLength = askRequest.pendingText.size();
+		if (data)
+		{
+			askRequest.decoder.decode(data, length, askRequest.pendingText);
+		}
+		else
+		{
+			askRequest.decoder.finish(askRequest.pendingText);
+		}
+		askRequest.responseText.append(askRequest.pendingText, pendingLength, std::string::npos);
+		isFlushPosted = pendingLength > 0 || askRequest.pendingText.empty();
+	}
+	if (!isFlushPosted)
+	{
+		std::shared_ptr<AskOllamaRequest> askRequestPtr = askRequest.shared_from_this();
+		_uiDispatcher.post([askRequestPtr]() { flushAnswer(*askRequestPtr); });
+	}
+}
+
+// Insert the fragments received since the last frame with one write (UI thread)
+void flushAnswer(AskOllamaRequest& askRequest)
+{
+	std::string& text = askRequest.flushText;
+	{
+		std::lock_guard<std::mutex> lock(askRequest.pendingMutex);
+		text.swap(askRequest.pendingText);
+	}
+	if (text.empty())
+	{
+		return;
+	}
+
+	askRequest.sink.write(text);
+	text.clear();
+}
+
+// Handle the finished request (engine thread): deliver it to the UI thread
+void onOllamaResponse(AskOllamaRequest& askRequest, const RequestResult& result)
+{
+	if (askRequest.stream)
+	{
+		askRequest.stream->finish();
+		queueAnswer(askRequest, nullptr, 0); // No `done` chunk (cancelled / cut): the carried bytes
+	}
+
+	std::shared_ptr<AskOllamaRequest> askRequestPtr = askRequest.shared_from_this();
+	_uiDispatcher.post([askRequestPtr, result]()
+	{
+		flushAnswer(*askRequestPtr);
 
-	// cURL SetOpts
-	curl_easy_setopt(curl, CURLOPT_URL, OpenAIURL.c_str());
-	if (ProxyURL != "" && ProxyURL != "0")
+		// Hide loader dialog (if it was the last request)
+		onAskRequestFinished(result.id);
+
+		applyOllamaResponse(*askRequestPtr, result);
+		askRequestPtr->sink.finish();
+	});
+}
+
+// Insert the response / show the error (UI thread)
+void applyOllamaResponse(AskOllamaRequest& askRequest, const RequestResult& result)
+{
+	ScintillaSink& sink = askRequest.sink;
+
+	// Cancelled by the user: keep the text streamed so far, no error message
+	if (result.isCancelled)
 	{
-		curl_easy_setopt(curl, CURLOPT_PROXY, ProxyURL.c_str());
+		return;
 	}
-	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-	curl_easy_setopt(curl, CURLOPT_HTTPPROXYTUNNEL, 1L); // Corp. proxies etc.
-	curl_easy_setopt(curl, CURLOPT_CAINFO, toUTF8(CACertFilePath).c_str());
-	curl_easy_setopt(curl, CURLOPT_USERAGENT, userAgent);
-	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headerList);
-	curl_easy_setopt(curl, CURLOPT_POSTFIELDS, JSONRequest.c_str());
-	curl_easy_setopt(curl, CURLOPT_POST, 1L);
-	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &JSONResponse);
-	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, OpenAIcURLCallback); // Send all data to this function
 
-	// Perform the request, res will get the return code
-	res = curl_easy_perform(curl);
-	bool isCurlOK = (res == CURLE_OK);
+	// Return if something went wrong
+	if (!result.isOK())
+	{
+		std::wstring curlError = TEXT("An error occurred while accessing the Ollama server:\n") + utf8ToWide(result.errorText.substr(0, 400));
+		::MessageBox(nppData._nppHandle, curlError.c_str(), TEXT("Ollama: Connection Error"), MB_ICONERROR);
+		return;
+	}
 
-	// Handle response + check for errors
-	if (!isCurlOK)
+	// Streaming: the response is already inserted
+	if (askRequest.stream)
 	{
-		char curl_error[512];
-		sprintf(curl_error, "An error occurred while accessing the Ollama server:\n%s", curl_easy_strerror(res));
-		::MessageBox(nppData._nppHandle, myMultiByteToWideChar(curl_error), TEXT("Ollama: Connection Error"), MB_ICONERROR);
+		std::string errorResponse = askRequest.errorResponse;
+		std::string responseText = askRequest.responseText;
+		if (!errorResponse.empty())
+		{
+			std::wstring errorResponseWide = utf8ToWide(errorResponse.substr(0, 511));
+			::MessageBox(nppData._nppHandle, errorResponseWide.c_str(), TEXT("Ollama: Error response"), MB_ICONEXCLAMATION);
+		}
+		else if (responseText.empty() && !askRequest.stream->invalidText().empty())
+		{
+			sink.write(askRequest.stream->invalidText());
+			::MessageBox(nppData._nppHandle, TEXT("Invalid or non-JSON response!\n\nSee details in the main window"), TEXT("Ollama: Invalid response"), MB_ICONERROR);
+		}
+		else if (!responseText.empty())
+		{
+			// Update chat history
+			addChatHistory(askRequest, responseText);
+			updateChatContext(askRequest);
+			cacheOllamaResponse(askRequest, responseText);
+		}
+		return;
 	}
 
-	// Cleanup (including headers)
-	curl_easy_cleanup(curl);
-	curl_slist_free_all(headerList);
-	return isCurlOK;
+	// Parse response: the known fields only, in one pass (no DOM of the whole response + its `context` array)
+	const std::string& JSONBuffer = askRequest.JSONBuffer;
+	std::string parseError;
+	if (!parseOllamaChunk(JSONBuffer.data(), JSONBuffer.size(), askRequest.finalChunk, &parseError))
+	{
+		std::string responseText = JSONBuffer.c_str();
+		responseText += "\n\n" + parseError;
+		sink.write(responseText);
+		::MessageBox(nppData._nppHandle, TEXT("Invalid or non-JSON response!\n\nSee details in the main window"), TEXT("Ollama: Invalid response"), MB_ICONERROR);
+		return;
+	}
+
+	// Handle Ollama response format (`response`: /api/generate; `message.content`: /api/chat)
+	const OllamaChunk& finalChunk = askRequest.finalChunk;
+	if (finalChunk.hasResponse)
+	{
+		// Replace the question with the response (or add it after the question), wherever it is now
+		sink.write(finalChunk.response);
+
+		// Update chat history
+		addChatHistory(askRequest, finalChunk.response);
+		updateChatContext(askRequest);
+		cacheOllamaResponse(askRequest, finalChunk.response);
+
+		// No need to update token counts for Ollama as it doesn't track them
+	}
+	else if (!finalChunk.error.empty())
+	{
+		std::wstring errorResponseWide = utf8ToWide(finalChunk.error.substr(0, 511));
+		::MessageBox(nppData._nppHandle, errorResponseWide.c_str(), TEXT("Ollama: Error response"), MB_ICONEXCLAMATION);
+	}
+	else
+	{
+		::MessageBox(nppData._nppHandle, TEXT("Missing 'response' in JSON response!"), TEXT("Ollama: Invalid answer"), MB_ICONEXCLAMATION);
+	}
+}
+
+// Answer from the response cache: same steps as a finished request, without the loader (UI thread)
+void applyCachedResponse(AskOllamaRequest& askRequest, const CachedResponse& cachedResponse)
+{
+	askRequest.isCached = true;
+	askRequest.responseText = cachedResponse.response;
+	askRequest.finalChunk.response = cachedResponse.response;
+	askRequest.finalChunk.context = cachedResponse.context;
+	askRequest.sink.write(cachedResponse.response);
+	askRequest.sink.finish();
+	addChatHistory(askRequest, cachedResponse.response);
+	updateChatContext(askRequest);
+}
+
+// Keep a successful answer for the same request later (UI thread)
+void cacheOllamaResponse(const AskOllamaRequest& askRequest, const std::string& responseText)
+{
+	if (askRequest.cacheKey.empty() || responseText.empty())
+	{
+		return;
+	}
+	CachedResponse cachedResponse;
+	cachedResponse.response = responseText;
+	cachedResponse.context = askRequest.finalChunk.context;
+	_responseCache.put(askRequest.cacheKey, cachedResponse);
+	_diskCache.put(askRequest.cacheKey, cachedResponse);
+	if (!askRequest.embedding.empty())
+	{
+		_semanticCache.put(askRequest.semanticScope, askRequest.embedding, cachedResponse);
+	}
+}
+
+// Store the returned `context` for the next question + count evaluated prompt tokens (UI thread)
+void updateChatContext(const AskOllamaRequest& askRequest)
+{
+	const OllamaChunk& finalChunk = askRequest.finalChunk;
+	std::lock_guard<std::mutex> lock(chatContextsMutex);
+	if (askRequest.isCached)
+	{
+		// Nothing was evaluated: the prompt statistics are about Ollama's requests only
+	}
+	else if (askRequest.isFollowUp)
+	{
+		chatContextStats.followUps++;
+		chatContextStats.followUpPromptTokens += finalChunk.promptEvalCount;
+		chatContextStats.followUpPromptNs += finalChunk.promptEvalDuration;
+	}
+	else
+	{
+		chatContextStats.newConversations++;
+		chatContextStats.newPromptTokens += finalChunk.promptEvalCount;
+		chatContextStats.newPromptNs += finalChunk.promptEvalDuration;
+	}
+
+	if (askRequest.isChat && !finalChunk.context.empty())
+	{
+		ChatContext& chatContext = chatContexts[askRequest.bufferID];
+		chatContext.context = finalChunk.context;
+		chatContext.turns = askRequest.isFollowUp ? chatContext.turns + 1 : 1;
+	}
+}
+
+// Add a chat question + answer to the history of its document (UI thread)
+void addChatHistory(const AskOllamaRequest& askRequest, const std::string& responseText)
+{
+	if (!askRequest.isChat)
+	{
+		return; // Not part of a conversation
+	}
+	std::lock_guard<std::mutex> lock(chatHistoryMutex);
+	auto chatSession = chatSessions.find(askRequest.bufferID);
+	if (chatSession == chatSessions.end())
+	{
+		chatSession = chatSessions.insert({ askRequest.bufferID, ChatSession() }).first;
+		chatSession->second.history.setCapacity((size_t)_chatSettingsDlg.chatSetting_chatLimit);
+	}
+	chatSession->second.history.add(askRequest.question, responseText);
+}
+
+// Rough token estimate of a chat message (~4 bytes per token + role/template overhead)
+size_t estimateTokens(const std::string& text)
+{
+	return (text.length() + 3) / 4 + 4;
+}
+
+// Build `/api/chat` messages: system, history turns of the document fitting the token budget, then the question.
+// The history is trimmed from the oldest turn, in big steps (down to half of the budget): the sent prefix stays the same
+// for the next questions, so Ollama can reuse its prompt cache instead of evaluating the whole history again.
+json buildChatMessages(LRESULT bufferID, const std::string& systemText, const std::string& question, int contextLength, int maxTokens, bool& hasHistory)
+{
+	json messages = json::array();
+	if (!systemText.empty())
+	{
+		messages.push_back({ {"role", "system"}, {"content", systemText} });
+	}
+
+	// Budget: context length - answer - system - question
+	long long budget = (contextLength > 0) ? contextLength : 2048; // Ollama's default `num_ctx`
+	budget -= (maxTokens > 0) ? maxTokens : budget / 4;
+	budget -= (long long)(estimateTokens(systemText) + estimateTokens(question));
+
+	hasHistory = false;
+	{
+		std::lock_guard<std::mutex> lock(chatHistoryMutex);
+		auto chatSession = chatSessions.find(bufferID);
+		ChatSession emptySession;
+		ChatHistory& chatHistory = (chatSession != chatSessions.end()) ? chatSession->second.history : emptySession.history;
+		unsigned long long& chatHistoryFirstTurn = (chatSession != chatSessions.end()) ? chatSession->second.firstTurn : emptySession.firstTurn;
+		if (chatHistoryFirstTurn < chatHistory.firstTurnNumber() || chatHistoryFirstTurn > chatHistory.endTurnNumber())
+		{
+			chatHistoryFirstTurn = chatHistory.firstTurnNumber(); // Turns dropped by `chatSetting_chatLimit`
+		}
+
+		size_t firstIndex = (size_t)(chatHistoryFirstTurn - chatHistory.firstTurnNumber());
+		long long used = 0;
+		for (size_t i = firstIndex; i < chatHistory.size(); i++)
+		{
+			used += estimateTokens(chatHistory.at(i).question) + estimateTokens(chatHistory.at(i).answer);
+		}
+
+		// Over budget: drop the oldest turns
+		if (used > budget)
+		{
+			while (firstIndex < chatHistory.size() && used > budget / 2)
+			{
+				used -= estimateTokens(chatHistory.at(firstIndex).question) + estimateTokens(chatHistory.at(firstIndex).answer);
+				firstIndex++;
+				chatHistoryFirstTurn++;
+			}
+		}
+
+		for (size_t i = firstIndex; i < chatHistory.size(); i++)
+		{
+			messages.push_back({ {"role", "user"}, {"content", chatHistory.at(i).question} });
+			messages.push_back({ {"role", "assistant"}, {"content", chatHistory.at(i).answer} });
+			hasHistory = true;
+		}
+	}
+
+	messages.push_back({ {"role", "user"}, {"content", question} });
+	return messages;
+}
+
+// Forget the conversation of a closed document
+void onDocumentClosed(UINT_PTR bufferID)
+{
+	_endpointBalancer.unpin((uint64_t)bufferID);
+	{
+		std::lock_guard<std::mutex> lock(chatHistoryMutex);
+		chatSessions.erase((LRESULT)bufferID);
+	}
+	std::lock_guard<std::mutex> lock(chatContextsMutex);
+	chatContexts.erase((LRESULT)bufferID);
+}
+
+// Init cURL once: pooled handles + keep-alive connections, cached CA bundle path + user agent
+void initCurlTransport()
+{
+	if (!_curlTransport.init())
+	{
+		::MessageBox(nppData._nppHandle, TEXT("cURL could not be initialized"), TEXT("NppOllama: Connection Error"), MB_ICONERROR);
+		return;
+	}
+
+	// Get the CA bundle file for cURL
+	TCHAR CACertFilePath[MAX_PATH];
+	const TCHAR CACertFileName[] = TEXT("NppOpenAI\\cacert.pem");
+	::SendMessage(nppData._nppHandle, NPPM_GETPLUGINHOMEPATH, MAX_PATH, (LPARAM)CACertFilePath);
+	PathAppend(CACertFilePath, CACertFileName);
+	_curlTransport.setCACertPath(wideToUtf8(CACertFilePath));
+
+	char userAgent[255];
+	sprintf(userAgent, "NppOllama/%s", NPPOPENAI_VERSION);
+	_curlTransport.setUserAgent(userAgent);
+
+	// Start the thread driving every transfer (`parallel_requests` is applied by `loadConfig()`)
+	_requestEngine.start(_configStore.get()->parallelRequests);
 }
 
 // Open config file
@@ -572,7 +1327,7 @@ After saving this file, don't forget to click Plugins » NppOllama » Load Confi
 void keepQuestionToggler()
 {
 	isKeepQuestion = !isKeepQuestion;
-	::CheckMenuItem(::GetMenu(nppData._nppHandle), funcItem[6]._cmdID, MF_BYCOMMAND | (isKeepQuestion ? MF_CHECKED : MF_UNCHECKED));
+	::CheckMenuItem(::GetMenu(nppData._nppHandle), funcItem[7]._cmdID, MF_BYCOMMAND | (isKeepQuestion ? MF_CHECKED : MF_UNCHECKED));
 }
 
 // Open Chat Settings dialog
@@ -581,7 +1336,154 @@ void openChatSettingsDlg()
 	_chatSettingsDlg.doDialog();
 }
 
+// Show plugin statistics (connection reuse etc.)
+void openStatsDlg()
+{
+	CurlTransportStats transportStats = _curlTransport.stats();
+	std::wstring statsText = TEXT("Connections\n");
+	statsText += TEXT("  Requests: ") + std::to_wstring(transportStats.requests) + TEXT("\n");
+	statsText += TEXT("  New connections: ") + std::to_wstring(transportStats.connectionsOpened) + TEXT("\n");
+	statsText += TEXT("  Reused (keep-alive) connections: ") + std::to_wstring(transportStats.connectionsReused) + TEXT("\n");
+	statsText += TEXT("  cURL handles created: ") + std::to_wstring(transportStats.handlesCreated) + TEXT("\n");
+
+	RequestEngineStats engineStats = _requestEngine.stats();
+	statsText += TEXT("\nRequests\n");
+	statsText += TEXT("  Submitted: ") + std::to_wstring(engineStats.submitted) + TEXT("\n");
+	statsText += TEXT("  Completed: ") + std::to_wstring(engineStats.completed) + TEXT("\n");
+	statsText += TEXT("  Failed: ") + std::to_wstring(engineStats.failed) + TEXT("\n");
+	statsText += TEXT("  Cancelled: ") + std::to_wstring(engineStats.cancelled) + TEXT(", rejected (queue full): ") + std::to_wstring(engineStats.rejected) + TEXT("\n");
+	statsText += TEXT("  Coalesced (same request already in flight): ") + std::to_wstring(engineStats.coalesced) + TEXT("\n");
+	statsText += TEXT("  Running / queued: ") + std::to_wstring(engineStats.inFlight) + TEXT(" / ") + std::to_wstring(engineStats.pending) + TEXT("\n");
+	statsText += TEXT("  Max. running at once: ") + std::to_wstring(engineStats.maxInFlightSeen) + TEXT("\n");
+	const TCHAR* priorityNames[] = { TEXT("Interactive"), TEXT("Normal"), TEXT("Background") };
+	statsText += TEXT("  Queue wait (p95 / avg. / max.):\n");
+	for (size_t priority = 0; priority < (size_t)RequestPriority::Count; priority++)
+	{
+		const RequestClassStats& classStats = engineStats.classes[priority];
+		statsText += TEXT("    ") + std::wstring(priorityNames[priority]) + TEXT(": ") + std::to_wstring(classStats.waitP95Microseconds / 1000) + TEXT(" / ")
+			+ std::to_wstring(classStats.started > 0 ? classStats.waitMicroseconds / classStats.started / 1000 : 0) + TEXT(" / ")
+			+ std::to_wstring(classStats.maxWaitMicroseconds / 1000) + TEXT(" ms, ") + std::to_wstring(classStats.started) + TEXT(" started");
+		if (classStats.preempted > 0)
+		{
+			statsText += TEXT(", ") + std::to_wstring(classStats.preempted) + TEXT(" preempted");
+		}
+		statsText += TEXT("\n");
+	}
+
+	std::vector<EndpointStats> endpointStats = _endpointBalancer.stats();
+	if (endpointStats.size() > 1)
+	{
+		statsText += TEXT("\nServers (requests / failed / running, latency EWMA)\n");
+		for (const EndpointStats& endpoint : endpointStats)
+		{
+			statsText += TEXT("  ") + utf8ToWide(endpoint.baseURL) + TEXT(": ") + std::to_wstring(endpoint.requests) + TEXT(" / ") + std::to_wstring(endpoint.failures)
+				+ TEXT(" / ") + std::to_wstring(endpoint.outstanding) + TEXT(", ") + std::to_wstring((unsigned long long)(endpoint.latencyEWMA * 1000)) + TEXT(" ms")
+				+ ((endpoint.consecutiveFailures > 0) ? TEXT(", ejected after ") + std::to_wstring(endpoint.consecutiveFailures) + TEXT(" failures\n") : TEXT("\n"));
+		}
+	}
+
+	UiDispatcherStats dispatcherStats = _uiDispatcher.stats();
+	statsText += TEXT("\nEditor updates\n");
+	statsText += TEXT("  Results + fragments: ") + std::to_wstring(dispatcherStats.tasks) + TEXT(" in ") + std::to_wstring(dispatcherStats.batches) + TEXT(" batches (max. ")
+		+ std::to_wstring(dispatcherStats.maxBatch) + TEXT(" at once)\n");
+
+	ScintillaSinkStats sinkStats = ScintillaSink::stats();
+	statsText += TEXT("  Answer text: ") + std::to_wstring(sinkStats.bytes / 1024) + TEXT(" KB in ") + std::to_wstring(sinkStats.writes) + TEXT(" writes (")
+		+ std::to_wstring(sinkStats.largeWrites) + TEXT(" large), ") + std::to_wstring(sinkStats.undoGroups) + TEXT(" undo steps\n");
+	if (sinkStats.bytes > 0)
+	{
+		statsText += TEXT("  Insertion cost: ") + std::to_wstring(sinkStats.microseconds * 1024 / sinkStats.bytes) + TEXT(" \u00B5s per KB\n");
+	}
+
+	ChatContextStats contextStats;
+	{
+		std::lock_guard<std::mutex> lock(chatContextsMutex);
+		contextStats = chatContextStats;
+	}
+	statsText += TEXT("\nPrompt evaluation (avg. tokens / ms per question)\n");
+	statsText += TEXT("  New conversations: ") + std::to_wstring(contextStats.newConversations);
+	if (contextStats.newConversations > 0)
+	{
+		statsText += TEXT(" (") + std::to_wstring(contextStats.newPromptTokens / contextStats.newConversations) + TEXT(" / ")
+			+ std::to_wstring(contextStats.newPromptNs / contextStats.newConversations / 1000000) + TEXT(" ms)");
+	}
+	statsText += TEXT("\n  Chat follow-ups (context or history): ") + std::to_wstring(contextStats.followUps);
+	if (contextStats.followUps > 0)
+	{
+		statsText += TEXT(" (") + std::to_wstring(contextStats.followUpPromptTokens / contextStats.followUps) + TEXT(" / ")
+			+ std::to_wstring(contextStats.followUpPromptNs / contextStats.followUps / 1000000) + TEXT(" ms)");
+	}
+	statsText += TEXT("\n");
+
+	ResponseCacheStats cacheStats = _responseCache.stats();
+	statsText += TEXT("\nResponse cache\n");
+	statsText += TEXT("  Hits: ") + std::to_wstring(cacheStats.hits) + TEXT(", misses: ") + std::to_wstring(cacheStats.misses)
+		+ TEXT(", bypassed (temperature > 0): ") + std::to_wstring(cacheStats.bypassed) + TEXT("\n");
+	statsText += TEXT("  Entries: ") + std::to_wstring(cacheStats.entries) + TEXT(" (") + std::to_wstring(cacheStats.bytes / 1024) + TEXT(" / ")
+		+ std::to_wstring(cacheStats.maxBytes / 1024) + TEXT(" KB), evictions: ") + std::to_wstring(cacheStats.evictions) + TEXT("\n");
+	if (cacheStats.hits > 0)
+	{
+		statsText += TEXT("  Average hit: ") + std::to_wstring(cacheStats.hitMicroseconds / cacheStats.hits) + TEXT(" \u00B5s\n");
+	}
+
+	SemanticCacheStats semanticStats = _semanticCache.stats();
+	statsText += TEXT("\nSemantic cache (similar questions)\n");
+	statsText += TEXT("  Hits: ") + std::to_wstring(semanticStats.hits) + TEXT(" of ") + std::to_wstring(semanticStats.lookups) + TEXT(" lookups");
+	if (semanticStats.lookups > 0)
+	{
+		statsText += TEXT(" (") + std::to_wstring(semanticStats.hits * 100 / semanticStats.lookups) + TEXT("%)");
+	}
+	statsText += TEXT(", embedding errors: ") + std::to_wstring(semanticStats.embedErrors) + TEXT("\n");
+	statsText += TEXT("  Entries: ") + std::to_wstring(semanticStats.entries) + TEXT(" (") + std::to_wstring(semanticStats.dimension) + TEXT(" dimensions)\n");
+	if (semanticStats.lookups > 0)
+	{
+		statsText += TEXT("  Average lookup: ") + std::to_wstring(semanticStats.lookupMicroseconds / semanticStats.lookups / 1000) + TEXT(" ms (search: ")
+			+ std::to_wstring(semanticStats.searchMicroseconds / semanticStats.lookups) + TEXT(" \u00B5s)\n");
+	}
+
+	DiskCacheStats diskCacheStats = _diskCache.stats();
+	statsText += TEXT("\nDisk cache\n");
+	statsText += TEXT("  Hits: ") + std::to_wstring(diskCacheStats.hits) + TEXT(", misses: ") + std::to_wstring(diskCacheStats.misses)
+		+ TEXT(", writes: ") + std::to_wstring(diskCacheStats.writes) + TEXT("\n");
+	statsText += TEXT("  Entries: ") + std::to_wstring(diskCacheStats.entries) + TEXT(" (") + std::to_wstring(diskCacheStats.fileBytes / 1024) + TEXT(" / ")
+		+ std::to_wstring(diskCacheStats.maxBytes / 1024) + TEXT(" KB file), compactions: ") + std::to_wstring(diskCacheStats.compactions) + TEXT("\n");
+	if (diskCacheStats.hits + diskCacheStats.misses > 0)
+	{
+		statsText += TEXT("  Average lookup: ") + std::to_wstring(diskCacheStats.lookupMicroseconds / (diskCacheStats.hits + diskCacheStats.misses)) + TEXT(" \u00B5s\n");
+	}
+	if (diskCacheStats.recoveredBytes > 0)
+	{
+		statsText += TEXT("  Torn records dropped at startup: ") + std::to_wstring(diskCacheStats.recoveredBytes) + TEXT(" bytes\n");
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(chatHistoryMutex);
+		size_t turns = 0;
+		size_t bytes = 0;
+		for (const auto& chatSession : chatSessions)
+		{
+			turns += chatSession.second.history.size();
+			bytes += chatSession.second.history.bytes();
+		}
+		statsText += TEXT("\nChat history\n");
+		statsText += TEXT("  Documents: ") + std::to_wstring(chatSessions.size()) + TEXT(", turns: ") + std::to_wstring(turns)
+			+ TEXT(" (max. ") + std::to_wstring(_chatSettingsDlg.chatSetting_chatLimit) + TEXT(" per document)\n");
+		statsText += TEXT("  Text: ") + std::to_wstring((bytes + 1023) / 1024) + TEXT(" KB\n");
+	}
+
+	::MessageBox(nppData._nppHandle, statsText.c_str(), TEXT("NppOllama: Statistics"), MB_ICONINFORMATION);
+}
+
 // Update chat settings UI
 void updateChatSettings(bool isWriteToFile)
 {
 	HMENU chatMenu = ::GetMenu(nppData._nppHandle);
+
+	// Keep only the last `chatSetting_chatLimit` turns
+	{
+		std::lock_guard<std::mutex> lock(chatHistoryMutex);
+		for (auto& chatSession : chatSessions)
+		{
+			chatSession.second.history.setCapacity((size_t)_chatSettingsDlg.chatSetting_chatLimit);
+		}
+	}
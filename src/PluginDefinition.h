@@ -24,7 +24,24 @@
 //
 #include "PluginInterface.h"
 #include "DockingFeature/LoaderDlg.h"
+#include "ChatHistory.h"
+#include "ChunkedJob.h"
+#include "Config.h"
+#include "OllamaStream.h"
+#include "ScintillaSink.h"
+#include "DiskCache.h"
+#include "FileWatcher.h"
+#include "RequestEngine.h"
+#include "RequestTemplate.h"
+#include "ResponseCache.h"
+#include "SemanticCache.h"
+#include "Utf8Convert.h"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <nlohmann/json_fwd.hpp>
 
 // Plugin version info
 #define NPPOPENAI_VERSION "0.4.2.2"
@@ -50,7 +67,7 @@ const TCHAR NPP_PLUGIN_NAME[] = TEXT("NppOpenAI");
 //
 // Here define the number of your plugin commands
 //
-const int nbFunc = 10;
+const int nbFunc = 12;
 
 
 //
@@ -88,20 +105,98 @@ bool setCommand(size_t index, TCHAR *cmdName, PFUNCPLUGINCMD pFunc, ShortcutKey
 void loadConfigWithoutPluginSettings();
 void loadConfig(bool loadPluginSettings);
 void askChatGPT();
+bool reloadConfig(bool isForced, std::string& configErrors, bool& isInstructionsFound);
+void configErrorsWarning(const std::string& configErrors);
+std::string getSelectedText(HWND curScintilla, size_t selstart, size_t selend);
+std::string getTextRange(HWND curScintilla, size_t start, size_t end);
+std::string toUTF8FromDocument(HWND curScintilla, const std::string& text);
+void askOllamaInChunks();
+void cancelAskOllama();
 void openConfig();
 void openInsturctions();
 void keepQuestionToggler();
 void openChatSettingsDlg();
 void updateChatSettings(bool isWriteToFile = false);
+void openStatsDlg();
 void openAboutDlg();
 
 /*** HELPER FUNCTIONS ***/
-bool callOpenAI(std::string OpenAIURL, std::string ProxyURL, std::string JSONRequest, std::string& JSONResponse);
-static size_t OpenAIcURLCallback(void *contents, size_t size, size_t nmemb, void *userp);
+
+// Chat history of a document sent to `/api/chat` (chat mode)
+struct ChatSession
+{
+	ChatHistory history;             // Last `chatSetting_chatLimit` questions + answers (UTF-8)
+	unsigned long long firstTurn = 0; // Turn number of the first turn sent, see `buildChatMessages()`
+};
+
+// Ollama conversation of a document (chat mode)
+struct ChatContext
+{
+	std::vector<int> context; // Returned by `/api/generate`, sent back with the next question (no prompt re-evaluation)
+	int turns = 0;            // Answered questions, limited by `chatSetting_chatLimit`
+};
+
+// Prompt evaluation counters: new conversations vs. follow-ups continuing from `context`
+struct ChatContextStats
+{
+	unsigned long long newConversations   = 0;
+	unsigned long long newPromptTokens    = 0;
+	unsigned long long newPromptNs        = 0;
+	unsigned long long followUps          = 0;
+	unsigned long long followUpPromptTokens = 0;
+	unsigned long long followUpPromptNs   = 0;
+};
+
+// State of one "Ask Ollama" request, shared by the cURL callbacks
+struct AskOllamaRequest : public std::enable_shared_from_this<AskOllamaRequest>
+{
+	std::shared_ptr<const Config> config; // Snapshot taken when the question was asked
+	LRESULT bufferID = 0;      // Document of the question (key of its `ChatContext`)
+	bool isChat = false;
+	bool isFollowUp = false;   // `context` of a previous answer was sent
+	bool isStream = true;
+	bool isCached = false;     // Answered from `_responseCache`, Ollama was not called
+	std::string question;      // Selected text (UTF-8)
+	std::string cacheKey;      // URL + request body, empty if the answer must not be cached
+	bool isSemanticCached = false; // Look up / store the answer in `_semanticCache` too
+	uint64_t semanticScope = 0;    // Hash of the request without the question
+	std::vector<float> embedding;  // Of the question, set after a semantic cache miss
+	std::string JSONBuffer;    // Whole response (non-streaming mode)
+	std::string responseText;  // Streamed fragments received so far (complete code points)
+	Utf8StreamDecoder decoder; // Carries a code point split between two fragments, engine thread
+	std::string errorResponse;
+	ScintillaSink sink;        // Writes the answer at the question (follows the user's edits), UI thread
+	std::mutex pendingMutex;
+	std::string pendingText;   // Streamed fragments not inserted yet, see `flushAnswer()`
+	std::string flushText;     // Swapped with `pendingText`: both keep their capacity, UI thread
+	std::unique_ptr<OllamaStream> stream;
+	OllamaChunk finalChunk;    // The `done` chunk: context + metrics
+};
+
+RequestId callOpenAI(std::string OpenAIURL, std::string ProxyURL, std::string JSONRequest, std::function<void(const char*, size_t)> onData, std::function<void(const RequestResult&)> onComplete,
+	RequestPriority priority = RequestPriority::Normal, std::function<void()> onRequeue = nullptr, uint64_t session = 0);
+void onOllamaData(AskOllamaRequest& askRequest, const char* data, size_t length);
+void onOllamaChunk(AskOllamaRequest& askRequest, const OllamaChunk& chunk);
+void queueAnswer(AskOllamaRequest& askRequest, const char* data, size_t length);
+void onOllamaResponse(AskOllamaRequest& askRequest, const RequestResult& result);
+void updateChatContext(const AskOllamaRequest& askRequest);
+void onDocumentClosed(UINT_PTR bufferID);
+void addChatHistory(const AskOllamaRequest& askRequest, const std::string& responseText);
+size_t estimateTokens(const std::string& text);
+nlohmann::json buildChatMessages(LRESULT bufferID, const std::string& systemText, const std::string& question, int contextLength, int maxTokens, bool& hasHistory);
+void initCurlTransport();
+void applyOllamaResponse(AskOllamaRequest& askRequest, const RequestResult& result);
+void applyCachedResponse(AskOllamaRequest& askRequest, const CachedResponse& cachedResponse);
+void cacheOllamaResponse(const AskOllamaRequest& askRequest, const std::string& responseText);
+void flushAnswer(AskOllamaRequest& askRequest);
+void onChunkedJobFinished(ScintillaSink& sink, const ChunkedJobResult& result);
+void onAskRequestFinished(RequestId requestId);
+void askSemanticCache(std::shared_ptr<AskOllamaRequest> askRequest, const std::string& OpenAIURL, const std::string& ProxyURL, const std::string& JSONRequest);
+void onEmbedResponse(std::shared_ptr<AskOllamaRequest> askRequest, const RequestResult& result, const std::string& JSONBuffer, std::chrono::steady_clock::time_point startTime,
+	const std::string& OpenAIURL, const std::string& ProxyURL, const std::string& JSONRequest);
+void sendOllamaRequest(std::shared_ptr<AskOllamaRequest> askRequest, const std::string& OpenAIURL, const std::string& ProxyURL, const std::string& JSONRequest);
 void replaceSelected(HWND curScintilla, std::string responseText);
 void instructionsFileError(TCHAR* errorMessage, TCHAR* errorCaption);
-std::string toUTF8(std::wstring);
-TCHAR* myMultiByteToWideChar(char* fromChar);
 
 
 #endif //PLUGINDEFINITION_H
@@ -0,0 +1,738 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#include "RequestEngine.h"
+
+#include <algorithm>
+
+#define REQUESTENGINE_MAX_PENDING  256 // Queued requests (e.g. the shortcut held down), more are rejected
+#define REQUESTENGINE_WAIT_SAMPLES 512 // Queue waits kept per class for the p95
+#define REQUESTENGINE_MAX_REPLAY   (256 * 1024) // Response bytes kept for the callers joining a running transfer; longer ones can't be joined
+
+// Create the multi handle + start the engine thread
+bool RequestEngine::start(size_t maxInFlight)
+{
+	if (_isRunning)
+	{
+		return true;
+	}
+	if (_isThreadDetached)
+	{
+		return false; // The old engine thread may still use the members
+	}
+
+	_multi = curl_multi_init();
+	if (!_multi)
+	{
+		return false;
+	}
+
+	setMaxInFlight(maxInFlight);
+	_isThreadFinished = false;
+	_isStopping = false;
+	_isRunning = true;
+	_thread = std::thread(&RequestEngine::run, this);
+	return true;
+}
+
+// Stop the engine thread; unfinished transfers are aborted + dropped
+bool RequestEngine::stop(std::chrono::milliseconds deadline)
+{
+	if (!_isRunning)
+	{
+		return !_isThreadDetached;
+	}
+
+	// Cancelled transfers stop in their next callback, even while connecting or waiting for the first byte
+	std::unique_lock<std::mutex> lock(_mutex);
+	_isStopping = true;
+	for (auto& pending : _pending)
+	{
+		for (auto& transfer : pending)
+		{
+			transfer->isCancelled = true;
+		}
+	}
+	for (auto& activeTransfer : _active)
+	{
+		activeTransfer.second->isCancelled = true;
+	}
+	curl_multi_wakeup(_multi);
+
+	bool isFinished = _threadFinished.wait_for(lock, deadline, [this]() { return _isThreadFinished; });
+	lock.unlock();
+	_isRunning = false;
+	if (!isFinished)
+	{
+		// Still in a callback: the thread keeps using `_multi` (+ the cURL state of `_transport`) until it returns,
+		// so nothing is freed; the process is exiting
+		_thread.detach();
+		_isThreadDetached = true;
+		return false;
+	}
+	_thread.join();
+	curl_multi_cleanup(_multi);
+	_multi = nullptr;
+	return true;
+}
+
+void RequestEngine::setMaxInFlight(size_t maxInFlight)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_maxInFlight = (maxInFlight == 0) ? 1 : maxInFlight;
+	}
+	if (_multi)
+	{
+		curl_multi_wakeup(_multi);
+	}
+}
+
+// Queue a request + wake up the engine thread
+RequestId RequestEngine::submit(const OllamaRequest& request)
+{
+	if (!_isRunning || _isStopping)
+	{
+		return 0;
+	}
+
+	std::shared_ptr<Transfer> transfer = std::make_shared<Transfer>();
+	transfer->request = request;
+	transfer->bodyHash = std::hash<std::string>()(request.postFields);
+	transfer->isRequeueable = (bool)request.onRequeue;
+	transfer->engine = this;
+	transfer->queueTime = std::chrono::steady_clock::now();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		// Single flight: attach to the identical request instead of using another Ollama slot
+		std::shared_ptr<Transfer> sameTransfer = findSameTransfer(request, transfer->bodyHash);
+		if (sameTransfer)
+		{
+			std::shared_ptr<Follower> follower = std::make_shared<Follower>();
+			follower->id = ++_lastId;
+			follower->onData = request.onData;
+			follower->onComplete = request.onComplete;
+			follower->onRequeue = request.onRequeue;
+			sameTransfer->followers.push_back(follower);
+			_stats.submitted++;
+			_stats.coalesced++;
+			return follower->id;
+		}
+
+		size_t pendingCount = 0;
+		for (auto& pending : _pending)
+		{
+			pendingCount += pending.size();
+		}
+		if (pendingCount >= REQUESTENGINE_MAX_PENDING)
+		{
+			_stats.rejected++;
+			return 0;
+		}
+		transfer->id = ++_lastId;
+		_pending[(size_t)request.priority].push_back(transfer);
+		_stats.submitted++;
+	}
+	curl_multi_wakeup(_multi);
+	return transfer->id;
+}
+
+// Flag the request; the engine thread removes it on its next wake-up
+bool RequestEngine::cancel(RequestId id)
+{
+	if (id == 0 || !_isRunning)
+	{
+		return false;
+	}
+
+	bool isFound = false;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		std::vector<Transfer*> transfers;
+		for (auto& pending : _pending)
+		{
+			for (auto& transfer : pending)
+			{
+				transfers.push_back(transfer.get());
+			}
+		}
+		for (auto& activeTransfer : _active)
+		{
+			transfers.push_back(activeTransfer.second.get());
+		}
+
+		for (Transfer* transfer : transfers)
+		{
+			bool isWaited = false; // By a caller not cancelled
+			if (transfer->id == id)
+			{
+				transfer->isOwnerCancelled = true;
+				isFound = true;
+			}
+			isWaited = !transfer->isOwnerCancelled;
+			for (auto& follower : transfer->followers)
+			{
+				if (follower->id == id)
+				{
+					follower->isCancelled = true;
+					isFound = true;
+				}
+				isWaited = isWaited || !follower->isCancelled;
+			}
+			if (!isWaited)
+			{
+				transfer->isCancelled = true;
+			}
+		}
+	}
+
+	if (isFound)
+	{
+		curl_multi_wakeup(_multi);
+	}
+	return isFound;
+}
+
+RequestEngineStats RequestEngine::stats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	RequestEngineStats stats = _stats;
+	stats.inFlight = _active.size();
+	for (size_t priority = 0; priority < (size_t)RequestPriority::Count; priority++)
+	{
+		RequestClassStats& classStats = stats.classes[priority];
+		classStats.pending = _pending[priority].size();
+		classStats.inFlight = _activeCount[priority];
+		stats.pending += classStats.pending;
+		if (!_waitSamples[priority].empty())
+		{
+			std::vector<unsigned long long> waits = _waitSamples[priority];
+			std::vector<unsigned long long>::iterator p95 = waits.begin() + (waits.size() - 1) * 95 / 100;
+			std::nth_element(waits.begin(), p95, waits.end());
+			classStats.waitP95Microseconds = *p95;
+		}
+	}
+	return stats;
+}
+
+// The engine thread
+void RequestEngine::run()
+{
+	while (!_isStopping)
+	{
+		finishCancelledTransfers();
+		preemptBackgroundTransfers();
+		startPendingTransfers();
+
+		int runningTransfers = 0;
+		curl_multi_perform(_multi, &runningTransfers);
+
+		// Collect finished transfers
+		int messagesLeft = 0;
+		CURLMsg* message = nullptr;
+		while ((message = curl_multi_info_read(_multi, &messagesLeft)) != nullptr)
+		{
+			if (message->msg == CURLMSG_DONE)
+			{
+				finishTransfer(message->easy_handle, message->data.result);
+			}
+		}
+
+		// Sleep until there's network activity, a new request (`curl_multi_wakeup()`) or timeout
+		curl_multi_poll(_multi, nullptr, 0, 1000, nullptr);
+	}
+
+	// Shutdown: drop everything still running or waiting, WITHOUT calling `onComplete`
+	// (the UI thread may be waiting in `stop()`, so callbacks touching windows would deadlock)
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (auto& activeTransfer : _active)
+	{
+		curl_multi_remove_handle(_multi, activeTransfer.first);
+		curl_easy_cleanup(activeTransfer.first); // Not reusable: its connection is in the middle of a response
+		releaseEndpoint(*activeTransfer.second, 0.0, true, false);
+	}
+	_active.clear();
+	for (size_t priority = 0; priority < (size_t)RequestPriority::Count; priority++)
+	{
+		_pending[priority].clear();
+		_activeCount[priority] = 0;
+	}
+	_isThreadFinished = true;
+	_threadFinished.notify_all();
+}
+
+// Max. running transfers of a class: background work leaves a slot to the interactive requests
+size_t RequestEngine::classLimit(RequestPriority priority) const
+{
+	if (priority == RequestPriority::Background && _maxInFlight > 1)
+	{
+		return _maxInFlight - 1;
+	}
+	return _maxInFlight;
+}
+
+// Interactive requests waiting for a slot: abort the most recently started background transfers + queue them again (first in their class)
+void RequestEngine::preemptBackgroundTransfers()
+{
+	while (true)
+	{
+		std::shared_ptr<Transfer> transfer;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			size_t freeSlots = (_active.size() < _maxInFlight) ? _maxInFlight - _active.size() : 0;
+			if (_pending[(size_t)RequestPriority::Interactive].size() <= freeSlots)
+			{
+				return;
+			}
+			for (auto& activeTransfer : _active)
+			{
+				const std::shared_ptr<Transfer>& candidate = activeTransfer.second;
+				if (candidate->request.priority == RequestPriority::Background && candidate->isRequeueable && !candidate->isCancelled
+					&& (!transfer || candidate->id > transfer->id))
+				{
+					transfer = candidate;
+				}
+			}
+			if (!transfer)
+			{
+				return;
+			}
+			_active.erase(transfer->curl);
+			_activeCount[(size_t)RequestPriority::Background]--;
+			_stats.classes[(size_t)RequestPriority::Background].preempted++;
+		}
+
+		// Like a cancel: the connection is closed, Ollama frees the slot
+		curl_multi_remove_handle(_multi, transfer->curl);
+		curl_easy_setopt(transfer->curl, CURLOPT_ERRORBUFFER, nullptr);
+		_transport.releaseHandle(transfer->curl);
+		transfer->curl = nullptr;
+		transfer->errorBuffer[0] = '\0';
+		releaseEndpoint(*transfer, 0.0, true, false); // Chosen again at the restart
+		transfer->received.clear();
+		transfer->receivedLength = 0;
+		if (transfer->request.onRequeue)
+		{
+			transfer->request.onRequeue();
+		}
+
+		std::vector<std::shared_ptr<Follower>> followers;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			followers = transfer->followers;
+		}
+		for (auto& follower : followers)
+		{
+			if (follower->deliveredLength > 0 && follower->onRequeue)
+			{
+				follower->onRequeue(); // Requeueable like the transfer, see `findSameTransfer()`
+			}
+			follower->deliveredLength = 0;
+		}
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		transfer->isJoinable = true; // Nothing to replay yet
+		transfer->queueTime = std::chrono::steady_clock::now();
+		_pending[(size_t)RequestPriority::Background].push_front(transfer);
+	}
+}
+
+// Count a started transfer + its queue wait (locked)
+void RequestEngine::countStart(const Transfer& transfer)
+{
+	size_t priority = (size_t)transfer.request.priority;
+	unsigned long long wait = (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - transfer.queueTime).count();
+	RequestClassStats& classStats = _stats.classes[priority];
+	classStats.started++;
+	classStats.waitMicroseconds += wait;
+	if (wait > classStats.maxWaitMicroseconds)
+	{
+		classStats.maxWaitMicroseconds = wait;
+	}
+	std::vector<unsigned long long>& waitSamples = _waitSamples[priority];
+	if (waitSamples.size() < REQUESTENGINE_WAIT_SAMPLES)
+	{
+		waitSamples.push_back(wait);
+	}
+	else
+	{
+		waitSamples[_nextWaitSample[priority]] = wait;
+	}
+	_nextWaitSample[priority] = (_nextWaitSample[priority] + 1) % REQUESTENGINE_WAIT_SAMPLES;
+}
+
+// Move queued requests to the multi handle while there are free slots: the highest class first, within its limit
+void RequestEngine::startPendingTransfers()
+{
+	while (true)
+	{
+		std::shared_ptr<Transfer> transfer;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (_active.size() >= _maxInFlight)
+			{
+				return;
+			}
+			for (size_t priority = 0; priority < (size_t)RequestPriority::Count; priority++)
+			{
+				if (!_pending[priority].empty() && _activeCount[priority] < classLimit((RequestPriority)priority))
+				{
+					transfer = _pending[priority].front();
+					_pending[priority].pop_front();
+					countStart(*transfer);
+					break;
+				}
+			}
+			if (!transfer)
+			{
+				return;
+			}
+		}
+
+		transfer->curl = _transport.acquireHandle();
+		if (!transfer->curl)
+		{
+			RequestResult result;
+			result.id = transfer->id;
+			result.curlCode = CURLE_FAILED_INIT;
+			result.errorText = curl_easy_strerror(CURLE_FAILED_INIT);
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_stats.failed++;
+			}
+			completeTransfer(*transfer, result);
+			continue;
+		}
+
+		// A path: sent to the least loaded endpoint (or the one of its session)
+		const OllamaRequest& request = transfer->request;
+		std::string URL = request.URL;
+		if (!URL.empty() && URL[0] == '/')
+		{
+			std::string baseURL;
+			transfer->endpoint = _endpoints.acquire(request.session, baseURL);
+			URL = baseURL + URL;
+		}
+		_transport.prepareRequest(transfer->curl, URL, request.proxyURL, request.postFields, writeCallback, transfer.get());
+		curl_easy_setopt(transfer->curl, CURLOPT_ERRORBUFFER, transfer->errorBuffer);
+		curl_easy_setopt(transfer->curl, CURLOPT_NOPROGRESS, 0L);
+		curl_easy_setopt(transfer->curl, CURLOPT_XFERINFOFUNCTION, progressCallback);
+		curl_easy_setopt(transfer->curl, CURLOPT_XFERINFODATA, transfer.get());
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_active[transfer->curl] = transfer;
+			_activeCount[(size_t)transfer->request.priority]++;
+			if (_active.size() > _stats.maxInFlightSeen)
+			{
+				_stats.maxInFlightSeen = _active.size();
+			}
+		}
+		curl_multi_add_handle(_multi, transfer->curl);
+	}
+}
+
+// Drop cancelled requests from the queue + remove cancelled transfers from the multi handle right away;
+// cancelled callers of a transfer still waited for by others are just detached from it
+void RequestEngine::finishCancelledTransfers()
+{
+	std::vector<std::shared_ptr<Transfer>> cancelledPending;
+	std::vector<CURL*> cancelledActive;
+	std::vector<std::shared_ptr<Transfer>> cancelledOwners;
+	std::vector<std::shared_ptr<Follower>> cancelledFollowers;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		std::vector<std::shared_ptr<Transfer>> transfers;
+		for (auto& pending : _pending)
+		{
+			for (auto transfer = pending.begin(); transfer != pending.end(); )
+			{
+				if ((*transfer)->isCancelled)
+				{
+					cancelledPending.push_back(*transfer);
+					transfer = pending.erase(transfer);
+					_stats.cancelled++;
+				}
+				else
+				{
+					transfers.push_back(*transfer);
+					++transfer;
+				}
+			}
+		}
+		for (auto& activeTransfer : _active)
+		{
+			if (activeTransfer.second->isCancelled)
+			{
+				cancelledActive.push_back(activeTransfer.first);
+			}
+			else
+			{
+				transfers.push_back(activeTransfer.second);
+			}
+		}
+
+		for (auto& transfer : transfers)
+		{
+			if (transfer->isOwnerCancelled && transfer->request.onComplete)
+			{
+				cancelledOwners.push_back(transfer);
+				_stats.cancelled++;
+			}
+			std::vector<std::shared_ptr<Follower>>& followers = transfer->followers;
+			for (auto follower = followers.begin(); follower != followers.end(); )
+			{
+				if ((*follower)->isCancelled)
+				{
+					cancelledFollowers.push_back(*follower);
+					follower = followers.erase(follower);
+					_stats.cancelled++;
+				}
+				else
+				{
+					++follower;
+				}
+			}
+		}
+	}
+
+	RequestResult result;
+	result.curlCode = CURLE_ABORTED_BY_CALLBACK;
+	result.isCancelled = true;
+	result.errorText = "The request was cancelled";
+	for (auto& transfer : cancelledPending)
+	{
+		result.id = transfer->id;
+		completeTransfer(*transfer, result);
+	}
+	for (auto& transfer : cancelledOwners)
+	{
+		result.id = transfer->id;
+		transfer->request.onComplete(result);
+		transfer->request.onData = nullptr; // The followers still receive the data
+		transfer->request.onComplete = nullptr;
+		transfer->request.onRequeue = nullptr;
+	}
+	for (auto& follower : cancelledFollowers)
+	{
+		result.id = follower->id;
+		if (follower->onComplete)
+		{
+			follower->onComplete(result);
+		}
+	}
+	for (CURL* curl : cancelledActive)
+	{
+		finishTransfer(curl, CURLE_ABORTED_BY_CALLBACK);
+	}
+}
+
+// Detach a finished transfer, give back its handle and call `onComplete`
+void RequestEngine::finishTransfer(CURL* curl, CURLcode curlCode)
+{
+	std::shared_ptr<Transfer> transfer;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto activeTransfer = _active.find(curl);
+		if (activeTransfer == _active.end())
+		{
+			return;
+		}
+		transfer = activeTransfer->second;
+		_active.erase(activeTransfer);
+		_activeCount[(size_t)transfer->request.priority]--;
+		if (transfer->isCancelled)
+		{
+			_stats.cancelled++;
+		}
+		else if (curlCode == CURLE_OK)
+		{
+			_stats.completed++;
+		}
+		else
+		{
+			_stats.failed++;
+		}
+	}
+
+	RequestResult result;
+	result.id = transfer->id;
+	result.curlCode = curlCode;
+	result.isCancelled = transfer->isCancelled;
+	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &result.httpStatus);
+	curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &result.totalSeconds);
+	if (curlCode != CURLE_OK)
+	{
+		result.errorText = (transfer->errorBuffer[0] != '\0')
+			? transfer->errorBuffer
+			: curl_easy_strerror(curlCode);
+	}
+
+	// Removing an unfinished transfer closes its connection (so Ollama stops generating)
+	curl_multi_remove_handle(_multi, curl);
+	curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, nullptr);
+	_transport.releaseHandle(curl);
+	transfer->curl = nullptr;
+
+	// Server errors (e.g. model not loaded) count as failures of the endpoint too, a cancel does not
+	releaseEndpoint(*transfer, result.totalSeconds, result.isCancelled || (curlCode == CURLE_OK && result.httpStatus < 500), !result.isCancelled);
+
+	completeTransfer(*transfer, result);
+}
+
+// Give back the endpoint of a stopped transfer: `isSample` if `seconds` is the latency of the whole request
+void RequestEngine::releaseEndpoint(Transfer& transfer, double seconds, bool isOK, bool isSample)
+{
+	if (transfer.endpoint >= 0)
+	{
+		_endpoints.release(transfer.endpoint, seconds, isOK, isSample);
+		transfer.endpoint = -1;
+	}
+}
+
+// The identical request (URL, proxy, body, priority, requeueable or not) queued or running (locked)
+std::shared_ptr<RequestEngine::Transfer> RequestEngine::findSameTransfer(const OllamaRequest& request, size_t bodyHash) const
+{
+	auto isSame = [&request, bodyHash](const std::shared_ptr<Transfer>& transfer)
+	{
+		return !transfer->isCancelled && transfer->isJoinable && transfer->bodyHash == bodyHash && transfer->request.priority == request.priority
+			&& transfer->isRequeueable == (bool)request.onRequeue && transfer->request.postFields == request.postFields
+			&& transfer->request.URL == request.URL && transfer->request.proxyURL == request.proxyURL && transfer->request.session == request.session;
+	};
+	for (auto& activeTransfer : _active)
+	{
+		if (isSame(activeTransfer.second))
+		{
+			return activeTransfer.second;
+		}
+	}
+	for (auto& transfer : _pending[(size_t)request.priority])
+	{
+		if (isSame(transfer))
+		{
+			return transfer;
+		}
+	}
+	return nullptr;
+}
+
+// Pass the data not seen yet by the followers: `data` (just received), the whole response so far for a new one (engine thread).
+// The response is only kept for a replay up to `REQUESTENGINE_MAX_REPLAY` bytes: past it, the transfer can't be joined any more
+// (its copy is freed), so the followers attached by then are the last ones.
+void RequestEngine::deliverToFollowers(Transfer& transfer, const char* data, size_t length)
+{
+	transfer.receivedLength += length;
+	std::vector<std::shared_ptr<Follower>> followers;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (transfer.isJoinable && transfer.received.size() + length > REQUESTENGINE_MAX_REPLAY)
+		{
+			transfer.isJoinable = false;
+		}
+		followers = transfer.followers;
+	}
+	if (transfer.isJoinable)
+	{
+		transfer.received.append(data, length);
+	}
+
+	// `received`: bytes [0, its size) of the response, `data`: the last `length` bytes
+	size_t dataStart = transfer.receivedLength - length;
+	for (auto& follower : followers)
+	{
+		if (follower->isCancelled || !follower->onData)
+		{
+			follower->deliveredLength = transfer.receivedLength;
+			continue;
+		}
+		if (follower->deliveredLength < transfer.received.size())
+		{
+			follower->onData(transfer.received.data() + follower->deliveredLength, transfer.received.size() - follower->deliveredLength);
+			follower->deliveredLength = transfer.received.size();
+		}
+		if (follower->deliveredLength < transfer.receivedLength)
+		{
+			follower->onData(data + (follower->deliveredLength - dataStart), transfer.receivedLength - follower->deliveredLength);
+			follower->deliveredLength = transfer.receivedLength;
+		}
+	}
+
+	if (!transfer.isJoinable && !transfer.received.empty())
+	{
+		std::string().swap(transfer.received);
+	}
+}
+
+// Call `onComplete` of the request + its followers (the transfer is not queued/running any more: no new followers) (engine thread)
+void RequestEngine::completeTransfer(Transfer& transfer, const RequestResult& result)
+{
+	if (_isStopping)
+	{
+		return; // No `onComplete` after `stop()`: what it uses may already be destroyed
+	}
+	if (!result.isCancelled)
+	{
+		deliverToFollowers(transfer, nullptr, 0); // Attached after the last received data
+	}
+	std::vector<std::shared_ptr<Follower>> followers;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		followers.swap(transfer.followers);
+	}
+
+	if (transfer.request.onComplete)
+	{
+		transfer.request.onComplete(result);
+	}
+	for (auto& follower : followers)
+	{
+		RequestResult followerResult = result;
+		followerResult.id = follower->id;
+		followerResult.isCancelled = result.isCancelled || follower->isCancelled;
+		if (follower->onComplete)
+		{
+			follower->onComplete(followerResult);
+		}
+	}
+}
+
+// cURL write callback: pass the received bytes to the request
+size_t RequestEngine::writeCallback(void* contents, size_t size, size_t nmemb, void* userp)
+{
+	size_t realSize = size * nmemb;
+	Transfer* transfer = static_cast<Transfer*>(userp);
+	if (transfer->isCancelled)
+	{
+		return 0; // Abort the transfer (no more fragments after Cancel)
+	}
+	if (transfer->request.onData)
+	{
+		transfer->request.onData(static_cast<const char*>(contents), realSize);
+	}
+
+	// To the callers attached to this transfer, kept (bounded) for the later ones
+	transfer->engine->deliverToFollowers(*transfer, static_cast<const char*>(contents), realSize);
+	return realSize;
+}
+
+// cURL progress callback: non-zero aborts the transfer, even while waiting for the first byte
+int RequestEngine::progressCallback(void* userp, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+{
+	return static_cast<Transfer*>(userp)->isCancelled ? 1 : 0;
+}
@@ -0,0 +1,194 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#ifndef PLUGINNPPOPENAI_REQUESTENGINE_H
+#define PLUGINNPPOPENAI_REQUESTENGINE_H
+
+#include "CurlTransport.h"
+#include "EndpointBalancer.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+typedef unsigned long long RequestId;
+
+// Scheduling class of a request: queued requests of a higher class start first
+enum class RequestPriority
+{
+	Interactive = 0, // The user waits for it (Ask Ollama)
+	Normal,
+	Background,      // Bulk work (chunks): max. `maxInFlight` - 1 at once, preempted by interactive requests
+	Count
+};
+
+// Outcome of a transfer, passed to `OllamaRequest::onComplete`
+struct RequestResult
+{
+	RequestId id          = 0;
+	CURLcode curlCode     = CURLE_OK;
+	long httpStatus       = 0;
+	std::string errorText;      // cURL error message (if `curlCode != CURLE_OK`)
+	double totalSeconds   = 0.0;
+	bool isCancelled      = false; // Stopped by `RequestEngine::cancel()`
+
+	bool isOK() const { return curlCode == CURLE_OK; };
+};
+
+// A POST request to the Ollama API
+struct OllamaRequest
+{
+	std::string URL; // Full URL, or a path ("/api/chat"): sent to the `EndpointBalancer` endpoint chosen at start
+	std::string proxyURL;
+	std::string postFields;
+	std::function<void(const char* data, size_t length)> onData;  // Called for every received chunk (engine thread)
+	std::function<void(const RequestResult& result)> onComplete;  // Called once at the end (engine thread) -- keep it short
+	RequestPriority priority = RequestPriority::Normal;
+	std::function<void()> onRequeue; // Background: aborted for an interactive request + queued again, drop the received data (engine thread); not set: not preempted
+	uint64_t session = 0; // Path `URL`: the requests of a session (e.g. a chat) go to the same endpoint; 0: none
+};
+
+// Counters of a `RequestPriority`, see `RequestEngineStats::classes`
+struct RequestClassStats
+{
+	unsigned long long started   = 0;
+	unsigned long long preempted = 0;
+	unsigned long long waitMicroseconds    = 0; // Total time in the queue
+	unsigned long long waitP95Microseconds = 0; // Of the last `REQUESTENGINE_WAIT_SAMPLES` starts
+	unsigned long long maxWaitMicroseconds = 0;
+	size_t pending  = 0;
+	size_t inFlight = 0;
+};
+
+// Engine counters, see `RequestEngine::stats()`
+struct RequestEngineStats
+{
+	unsigned long long submitted = 0;
+	unsigned long long completed = 0;
+	unsigned long long failed    = 0;
+	unsigned long long cancelled = 0;
+	unsigned long long rejected  = 0; // The queue was full
+	unsigned long long coalesced = 0; // Attached to an identical request in flight instead of sending another one
+	size_t pending               = 0; // Waiting for a free transfer slot
+	size_t inFlight              = 0;
+	size_t maxInFlightSeen       = 0;
+	RequestClassStats classes[(size_t)RequestPriority::Count];
+};
+
+// One thread drives every transfer via `curl_multi_poll()`, instead of one blocking thread per request.
+// Requests over `maxInFlight` wait in a FIFO queue per `RequestPriority` (max. `REQUESTENGINE_MAX_PENDING` in all).
+class RequestEngine
+{
+public:
+	RequestEngine(CurlTransport& transport, EndpointBalancer& endpoints) : _transport(transport), _endpoints(endpoints) {};
+	~RequestEngine() { stop(); };
+
+	bool start(size_t maxInFlight);
+
+	// Abort every request (without `onComplete`) + wait max. `deadline` for the engine thread,
+	// which is left behind if a callback blocks it (shutdown must not hang the editor).
+	// Returns false in that case: the thread may still use cURL, so the caller must not clean up the `CurlTransport`
+	bool stop(std::chrono::milliseconds deadline = std::chrono::milliseconds(2000));
+	bool isRunning() const { return _isRunning; };
+
+	void setMaxInFlight(size_t maxInFlight);
+
+	// Queue a request; returns 0 if the engine is not running or the queue is full.
+	// The same request (URL, body, priority) queued or running already: it's not sent again, its data (so far + the rest) + result are passed to `request` too.
+	RequestId submit(const OllamaRequest& request);
+
+	// Abort a queued or running request: its connection is closed at once (which also frees the Ollama slot),
+	// `onComplete` is called with `isCancelled`. Returns `false` if the request is already finished.
+	// A request shared by coalesced callers is only aborted when all of them are cancelled.
+	bool cancel(RequestId id);
+
+	RequestEngineStats stats() const;
+
+protected:
+	// A caller attached to an identical transfer (single flight)
+	struct Follower
+	{
+		RequestId id = 0;
+		std::function<void(const char* data, size_t length)> onData;
+		std::function<void(const RequestResult& result)> onComplete;
+		std::function<void()> onRequeue;
+		size_t deliveredLength = 0; // Of the response (engine thread)
+		std::atomic<bool> isCancelled{ false };
+	};
+
+	struct Transfer
+	{
+		RequestId id = 0;
+		OllamaRequest request;
+		size_t bodyHash = 0;
+		bool isRequeueable = false;
+		int endpoint = -1; // Of `_endpoints` while running (path `URL`)
+		RequestEngine* engine = nullptr;
+		CURL* curl = nullptr;
+		char errorBuffer[CURL_ERROR_SIZE] = { 0, };
+		std::atomic<bool> isCancelled{ false };       // Whole transfer: nobody waits for it
+		std::atomic<bool> isOwnerCancelled{ false };  // `request` (its callbacks are dropped), the followers still wait
+		std::chrono::steady_clock::time_point queueTime; // Submitted / requeued
+		std::vector<std::shared_ptr<Follower>> followers; // Guarded by `_mutex`
+		bool isJoinable = true; // By new followers: the whole response so far is in `received` (set by the engine thread under `_mutex`)
+		std::string received;   // Replayed to late followers, max. `REQUESTENGINE_MAX_REPLAY` bytes (engine thread)
+		size_t receivedLength = 0; // Whole response so far (engine thread)
+	};
+
+	void run();
+	size_t classLimit(RequestPriority priority) const;
+	void preemptBackgroundTransfers();
+	void startPendingTransfers();
+	void countStart(const Transfer& transfer);
+	std::shared_ptr<Transfer> findSameTransfer(const OllamaRequest& request, size_t bodyHash) const;
+	void deliverToFollowers(Transfer& transfer, const char* data, size_t length);
+	void completeTransfer(Transfer& transfer, const RequestResult& result);
+	void finishCancelledTransfers();
+	void finishTransfer(CURL* curl, CURLcode curlCode);
+	void releaseEndpoint(Transfer& transfer, double seconds, bool isOK, bool isSample);
+	static size_t writeCallback(void* contents, size_t size, size_t nmemb, void* userp);
+	static int progressCallback(void* userp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
+
+	CurlTransport& _transport;
+	EndpointBalancer& _endpoints;
+	CURLM* _multi = nullptr;
+	std::thread _thread;
+	std::atomic<bool> _isRunning{ false };
+	std::atomic<bool> _isStopping{ false };
+	bool _isThreadDetached = false; // By `stop()`: `_multi` is left to the thread
+
+	mutable std::mutex _mutex; // Guards the members below
+	std::condition_variable _threadFinished;
+	bool _isThreadFinished = false;
+	std::deque<std::shared_ptr<Transfer>> _pending[(size_t)RequestPriority::Count];
+	std::map<CURL*, std::shared_ptr<Transfer>> _active;
+	size_t _activeCount[(size_t)RequestPriority::Count] = { 0, };
+	std::vector<unsigned long long> _waitSamples[(size_t)RequestPriority::Count]; // Ring of the last queue waits (µs)
+	size_t _nextWaitSample[(size_t)RequestPriority::Count] = { 0, };
+	size_t _maxInFlight = 4;
+	RequestId _lastId = 0;
+	RequestEngineStats _stats;
+};
+
+
+#endif // PLUGINNPPOPENAI_REQUESTENGINE_H
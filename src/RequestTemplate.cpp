@@ -0,0 +1,137 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#include "RequestTemplate.h"
+#include "Utf8Convert.h"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Append `text` (UTF-8) as a quoted, escaped JSON string; ill-formed UTF-8 becomes U+FFFD (like `error_handler_t::replace`)
+void appendJSONString(std::string& out, const std::string& text)
+{
+	if (!isValidUtf8(text.data(), text.size()))
+	{
+		std::string validText;
+		Utf8StreamDecoder decoder;
+		decoder.decode(text.data(), text.size(), validText);
+		decoder.finish(validText);
+		appendJSONString(out, validText);
+		return;
+	}
+
+	static const char hexDigits[] = "0123456789abcdef";
+	out += '"';
+	const char* data = text.data();
+	const char* end = data + text.size();
+	const char* run = data; // Bytes to copy as they are
+	for (; data < end; data++)
+	{
+		unsigned char c = (unsigned char)*data;
+		if (c >= 0x20 && c != '"' && c != '\\')
+		{
+			continue;
+		}
+		out.append(run, data);
+		run = data + 1;
+		switch (c)
+		{
+		case '"':  out += "\\\""; break;
+		case '\\': out += "\\\\"; break;
+		case '\n': out += "\\n"; break;
+		case '\r': out += "\\r"; break;
+		case '\t': out += "\\t"; break;
+		case '\b': out += "\\b"; break;
+		case '\f': out += "\\f"; break;
+		default:
+			out += "\\u00";
+			out += hexDigits[c >> 4];
+			out += hexDigits[c & 0x0F];
+			break;
+		}
+	}
+	out.append(run, end);
+	out += '"';
+}
+
+void RequestTemplate::compile(const Settings& settings)
+{
+	_settings = settings;
+
+	// Numbers are formatted by nlohmann::json: shortest round-trip form, independent of the C locale
+	_head = "{\"model\":";
+	appendJSONString(_head, settings.model);
+
+	// Sampling settings go in `options`: Ollama ignores them at the top level (`max_tokens` is its `num_predict`)
+	_head += ",\"options\":{\"temperature\":" + json(settings.temperature).dump();
+	_head += ",\"top_p\":" + json(settings.topP).dump();
+	if (settings.maxTokens > 0)
+	{
+		_head += ",\"num_predict\":" + std::to_string(settings.maxTokens);
+	}
+	if (settings.contextLength > 0)
+	{
+		_head += ",\"num_ctx\":" + std::to_string(settings.contextLength);
+	}
+	_head += '}';
+
+	_system.clear();
+	if (!settings.instructions.empty())
+	{
+		_system = ",\"system\":";
+		appendJSONString(_system, settings.instructions);
+	}
+}
+
+// `/api/generate`: instructions as `system`, `context` of a previous answer (optional)
+std::string RequestTemplate::generateBody(const std::string& prompt, const std::vector<int>* context, bool isStream) const
+{
+	std::string body;
+	body.reserve(_head.size() + _system.size() + prompt.size() + prompt.size() / 8 + (context ? context->size() * 7 : 0) + 64);
+	body += _head;
+	body += _system;
+	body += ",\"prompt\":";
+	appendJSONString(body, prompt);
+	if (context && !context->empty())
+	{
+		body += ",\"context\":[";
+		for (size_t i = 0; i < context->size(); i++)
+		{
+			if (i > 0)
+			{
+				body += ',';
+			}
+			body += std::to_string((*context)[i]);
+		}
+		body += ']';
+	}
+	body += isStream ? ",\"stream\":true}" : ",\"stream\":false}";
+	return body;
+}
+
+// `/api/chat`: `messagesJSON` is a serialized array (system message + history + question)
+std::string RequestTemplate::chatBody(const std::string& messagesJSON, bool isStream) const
+{
+	std::string body;
+	body.reserve(_head.size() + messagesJSON.size() + 32);
+	body += _head;
+	body += ",\"messages\":";
+	body += messagesJSON;
+	body += isStream ? ",\"stream\":true}" : ",\"stream\":false}";
+	return body;
+}
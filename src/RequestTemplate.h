@@ -0,0 +1,60 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#ifndef PLUGINNPPOPENAI_REQUESTTEMPLATE_H
+#define PLUGINNPPOPENAI_REQUESTTEMPLATE_H
+
+#include <string>
+#include <vector>
+
+// Append `text` (UTF-8) as a quoted, escaped JSON string; ill-formed UTF-8 becomes U+FFFD
+void appendJSONString(std::string& out, const std::string& text);
+
+// The parts of the Ollama request body which only change with the config (model, options, system text),
+// serialized once by `compile()`: a request only appends its escaped question (+ `context`) to a preallocated copy
+class RequestTemplate
+{
+public:
+	// Parsed + validated config values (UTF-8 strings)
+	struct Settings
+	{
+		std::string model;
+		double temperature = 0.7;
+		double topP        = 0.8;
+		int maxTokens      = 0; // `num_predict`, 0: not sent
+		int contextLength  = 0; // `num_ctx`, 0: not sent
+		std::string instructions;
+	};
+
+	void compile(const Settings& settings);
+	const Settings& settings() const { return _settings; };
+
+	// `/api/generate`: instructions as `system`, `context` of a previous answer (optional)
+	std::string generateBody(const std::string& prompt, const std::vector<int>* context, bool isStream) const;
+
+	// `/api/chat`: `messagesJSON` is a serialized array (system message + history + question)
+	std::string chatBody(const std::string& messagesJSON, bool isStream) const;
+
+protected:
+	Settings _settings;
+	std::string _head;   // `{"model":...,"options":{...}` -- not closed
+	std::string _system; // `,"system":"..."` or empty
+};
+
+
+#endif // PLUGINNPPOPENAI_REQUESTTEMPLATE_H
@@ -0,0 +1,202 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "ResponseAnchor.h"
+#include <atomic>
+
+// Shared hidden view (created by Notepad++), the documents are swapped in and out
+static HWND hiddenScintilla = nullptr;
+static LPARAM hiddenScintillaDocument = 0;
+
+// Indicator of every anchor (they are told apart by its value), -1 until allocated
+static int anchorIndicator = -1;
+
+// Next indicator value (1...SC_INDICVALUEMASK)
+static std::atomic<int> nextAnchorValue{ 0 };
+
+// Mark [start, end) of the document shown in `scintilla` (UI thread)
+bool ResponseAnchor::attach(const NppData& nppData, HWND scintilla, UINT_PTR bufferID, size_t start, size_t end)
+{
+	detach();
+	_nppHandle = nppData._nppHandle;
+	_bufferID = bufferID;
+	_value = (nextAnchorValue++ % SC_INDICVALUEMASK) + 1;
+	_lastEnd = end;
+
+	// Ask Notepad++ for an indicator no other plugin uses, once
+	if (anchorIndicator < 0)
+	{
+		int indicator = 0;
+		anchorIndicator = ::SendMessage(_nppHandle, NPPM_ALLOCATEINDICATOR, 1, (LPARAM)&indicator) ? indicator : RESPONSEANCHOR_INDICATOR;
+	}
+
+	// Hide the indicator in both views
+	::SendMessage(nppData._scintillaMainHandle, SCI_INDICSETSTYLE, anchorIndicator, INDIC_HIDDEN);
+	::SendMessage(nppData._scintillaSecondHandle, SCI_INDICSETSTYLE, anchorIndicator, INDIC_HIDDEN);
+
+	// Keep the document alive until `detach()`, even if its tab is closed
+	_document = (LPARAM)::SendMessage(scintilla, SCI_GETDOCPOINTER, 0, 0);
+	if (!_document)
+	{
+		return false;
+	}
+	::SendMessage(scintilla, SCI_ADDREFDOCUMENT, 0, _document);
+
+	if (end > start)
+	{
+		markRange(scintilla, start, end);
+	}
+	return true;
+}
+
+// Replace the whole target range with `text`
+bool ResponseAnchor::replace(const std::string& text)
+{
+	HWND view = getView();
+	if (!view)
+	{
+		return false;
+	}
+
+	size_t start, end;
+	if (!findRange(view, start, end))
+	{
+		start = end = _lastEnd;
+	}
+	::SendMessage(view, SCI_DELETERANGE, start, end - start);
+	::SendMessage(view, SCI_INSERTTEXT, start, (LPARAM)text.c_str());
+	_lastEnd = start + text.length();
+	markRange(view, start, _lastEnd);
+	return true;
+}
+
+// Insert `text` after the target range
+bool ResponseAnchor::append(const std::string& text)
+{
+	HWND view = getView();
+	if (!view)
+	{
+		return false;
+	}
+
+	size_t start, end;
+	if (!findRange(view, start, end))
+	{
+		start = end = _lastEnd;
+	}
+	::SendMessage(view, SCI_INSERTTEXT, end, (LPARAM)text.c_str());
+	_lastEnd = end + text.length();
+	markRange(view, start, _lastEnd);
+	return true;
+}
+
+// Remove the mark, release the document
+void ResponseAnchor::detach()
+{
+	if (!_document)
+	{
+		return;
+	}
+
+	HWND view = getView();
+	if (view)
+	{
+		size_t start, end;
+		if (findRange(view, start, end))
+		{
+			::SendMessage(view, SCI_SETINDICATORCURRENT, anchorIndicator, 0);
+			::SendMessage(view, SCI_INDICATORCLEARRANGE, start, end - start);
+		}
+	}
+
+	// Don't keep a released document in the hidden view
+	if (hiddenScintilla && hiddenScintillaDocument == _document)
+	{
+		::SendMessage(hiddenScintilla, SCI_SETDOCPOINTER, 0, 0);
+		hiddenScintillaDocument = 0;
+	}
+	if (hiddenScintilla)
+	{
+		::SendMessage(hiddenScintilla, SCI_RELEASEDOCUMENT, 0, _document);
+	}
+	_document = 0;
+}
+
+// The tab of the document is still open
+bool ResponseAnchor::isDocumentOpen() const
+{
+	return _document && ::SendMessage(_nppHandle, NPPM_GETPOSFROMBUFFERID, _bufferID, 0) != -1;
+}
+
+// Load the document into the hidden view (the visible views may switch to another tab at any time)
+HWND ResponseAnchor::getView() const
+{
+	if (!_document)
+	{
+		return nullptr;
+	}
+	if (!hiddenScintilla)
+	{
+		hiddenScintilla = (HWND)::SendMessage(_nppHandle, NPPM_CREATESCINTILLAHANDLE, 0, (LPARAM)NULL);
+		if (!hiddenScintilla)
+		{
+			return nullptr;
+		}
+	}
+	if (hiddenScintillaDocument != _document)
+	{
+		::SendMessage(hiddenScintilla, SCI_SETDOCPOINTER, 0, _document);
+		hiddenScintillaDocument = _document;
+	}
+	return hiddenScintilla;
+}
+
+// The document is shown in this (visible) view
+bool ResponseAnchor::isShownIn(HWND scintilla) const
+{
+	return _document && (LPARAM)::SendMessage(scintilla, SCI_GETDOCPOINTER, 0, 0) == _document;
+}
+
+// Find the run of the indicator with our value
+bool ResponseAnchor::findRange(HWND view, size_t& start, size_t& end) const
+{
+	size_t length = (size_t)::SendMessage(view, SCI_GETLENGTH, 0, 0);
+	size_t pos = 0;
+	while (pos < length)
+	{
+		size_t runEnd = (size_t)::SendMessage(view, SCI_INDICATOREND, anchorIndicator, pos);
+		if (runEnd <= pos)
+		{
+			break;
+		}
+		if (::SendMessage(view, SCI_INDICATORVALUEAT, anchorIndicator, pos) == _value)
+		{
+			start = pos;
+			end = runEnd;
+			return true;
+		}
+		pos = runEnd;
+	}
+	return false;
+}
+
+void ResponseAnchor::markRange(HWND view, size_t start, size_t end) const
+{
+	::SendMessage(view, SCI_SETINDICATORCURRENT, anchorIndicator, 0);
+	::SendMessage(view, SCI_SETINDICATORVALUE, _value, 0);
+	::SendMessage(view, SCI_INDICATORFILLRANGE, start, end - start);
+}
@@ -0,0 +1,70 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#ifndef PLUGINNPPOPENAI_RESPONSEANCHOR_H
+#define PLUGINNPPOPENAI_RESPONSEANCHOR_H
+
+#include "PluginInterface.h"
+#include <string>
+
+// Scintilla indicator marking the target ranges of the running requests (hidden), allocated with `NPPM_ALLOCATEINDICATOR`.
+// Only if Notepad++ can't allocate one (< v8.5.6): a number in the range left to plugins, which another plugin may also use
+#define RESPONSEANCHOR_INDICATOR 9
+
+// Target range of a response (the question, then question + answer so far), tracked with a hidden Scintilla indicator:
+// it moves with the user's edits, so the editor stays usable while Ollama is generating.
+// The document is written through a hidden Scintilla view, so it works even if its tab is no longer active.
+class ResponseAnchor
+{
+public:
+	// No `detach()` in the destructor: requests dropped at shutdown are destroyed by the engine thread while the UI thread waits for it
+	ResponseAnchor() = default;
+	ResponseAnchor(const ResponseAnchor&) = delete;
+	ResponseAnchor& operator=(const ResponseAnchor&) = delete;
+
+	// Mark [start, end) of the document shown in `scintilla` (UI thread)
+	bool attach(const NppData& nppData, HWND scintilla, UINT_PTR bufferID, size_t start, size_t end);
+
+	// Replace the whole target range with `text` / insert `text` after it; the text becomes part of the target range
+	bool replace(const std::string& text);
+	bool append(const std::string& text);
+
+	// Remove the mark, release the document -- call it when the request is finished
+	void detach();
+
+	bool isAttached() const { return _document != 0; };
+	bool isDocumentOpen() const;
+
+	// Scintilla to write the document with (hidden view), `nullptr` if not attached
+	HWND getView() const;
+
+	// The document is shown in this (visible) view
+	bool isShownIn(HWND scintilla) const;
+
+protected:
+	bool findRange(HWND view, size_t& start, size_t& end) const;
+	void markRange(HWND view, size_t start, size_t end) const;
+
+	HWND _nppHandle = nullptr;
+	UINT_PTR _bufferID = 0;
+	LPARAM _document = 0;      // Scintilla document pointer (referenced while attached)
+	int _value = 0;            // Indicator value of this anchor (to tell the anchors apart)
+	size_t _lastEnd = 0;       // Fallback if the user deleted the whole range
+};
+
+
+#endif // PLUGINNPPOPENAI_RESPONSEANCHOR_H
@@ -0,0 +1,163 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "ResponseCache.h"
+#include <chrono>
+#include <cstring>
+
+#define HASH_PRIME1 0x9E3779B185EBCA87ULL
+#define HASH_PRIME2 0xC2B2AE3D27D4EB4FULL
+#define HASH_PRIME3 0x165667B19E3779F9ULL
+#define HASH_PRIME4 0x85EBCA77C2B2AE63ULL
+#define HASH_PRIME5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t rotateLeft(uint64_t value, int bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+// 64-bit hash of a byte string, 8 bytes per step (single-lane xxHash64-style mixing)
+uint64_t hashBytes(const char* data, size_t length, uint64_t seed)
+{
+	uint64_t hash = seed + HASH_PRIME5 + (uint64_t)length;
+	const char* end = data + length;
+	while (end - data >= 8)
+	{
+		uint64_t word;
+		memcpy(&word, data, 8);
+		word = rotateLeft(word * HASH_PRIME2, 31) * HASH_PRIME1;
+		hash = rotateLeft(hash ^ word, 27) * HASH_PRIME1 + HASH_PRIME4;
+		data += 8;
+	}
+	while (data < end)
+	{
+		hash = rotateLeft(hash ^ ((uint64_t)(unsigned char)*data * HASH_PRIME5), 11) * HASH_PRIME1;
+		data++;
+	}
+
+	// Avalanche
+	hash ^= hash >> 33;
+	hash *= HASH_PRIME2;
+	hash ^= hash >> 29;
+	hash *= HASH_PRIME3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+// 0: disabled (and emptied)
+void ResponseCache::setMaxBytes(size_t maxBytes)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_maxBytes = maxBytes;
+	evict(maxBytes);
+}
+
+bool ResponseCache::isEnabled() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _maxBytes > 0;
+}
+
+bool ResponseCache::get(const std::string& key, CachedResponse& cachedResponse)
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	uint64_t hash = hashBytes(key.data(), key.size());
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto indexItem = _index.find(hash);
+	if (indexItem == _index.end() || indexItem->second->key != key)
+	{
+		_stats.misses++;
+		return false;
+	}
+
+	// Most recently used: move to the front
+	_entries.splice(_entries.begin(), _entries, indexItem->second);
+	cachedResponse = indexItem->second->value;
+	_stats.hits++;
+	_stats.hitMicroseconds += (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+	return true;
+}
+
+void ResponseCache::put(const std::string& key, const CachedResponse& cachedResponse)
+{
+	uint64_t hash = hashBytes(key.data(), key.size());
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_maxBytes == 0)
+	{
+		return;
+	}
+
+	// Replace the same key (or a colliding one)
+	auto indexItem = _index.find(hash);
+	if (indexItem != _index.end())
+	{
+		_bytes -= indexItem->second->bytes();
+		_entries.erase(indexItem->second);
+		_index.erase(indexItem);
+	}
+
+	Entry entry{ hash, key, cachedResponse };
+	size_t entryBytes = entry.bytes();
+	if (entryBytes > _maxBytes)
+	{
+		return; // Would evict everything else
+	}
+	evict(_maxBytes - entryBytes);
+
+	_entries.push_front(std::move(entry));
+	_index[hash] = _entries.begin();
+	_bytes += entryBytes;
+}
+
+void ResponseCache::countBypassed()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_stats.bypassed++;
+}
+
+void ResponseCache::clear()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_entries.clear();
+	_index.clear();
+	_bytes = 0;
+}
+
+ResponseCacheStats ResponseCache::stats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	ResponseCacheStats stats = _stats;
+	stats.entries = _entries.size();
+	stats.bytes = _bytes;
+	stats.maxBytes = _maxBytes;
+	return stats;
+}
+
+// Drop the least recently used entries until max. `maxBytes` are used (`_mutex` is locked)
+void ResponseCache::evict(size_t maxBytes)
+{
+	while (_bytes > maxBytes && !_entries.empty())
+	{
+		Entry& oldest = _entries.back();
+		_bytes -= oldest.bytes();
+		_index.erase(oldest.hash);
+		_entries.pop_back();
+		_stats.evictions++;
+	}
+}
@@ -0,0 +1,88 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#ifndef PLUGINNPPOPENAI_RESPONSECACHE_H
+#define PLUGINNPPOPENAI_RESPONSECACHE_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+// 64-bit hash of a byte string, 8 bytes per step (stable across runs, usable on disk too)
+uint64_t hashBytes(const char* data, size_t length, uint64_t seed = 0);
+
+// A cached answer
+struct CachedResponse
+{
+	std::string response;
+	std::vector<int> context; // `/api/generate` chat: continue the conversation from here
+};
+
+struct ResponseCacheStats
+{
+	unsigned long long hits      = 0;
+	unsigned long long misses    = 0;
+	unsigned long long bypassed  = 0; // Not cacheable (e.g. temperature > 0)
+	unsigned long long evictions = 0;
+	unsigned long long hitMicroseconds = 0;
+	size_t entries = 0;
+	size_t bytes   = 0;
+	size_t maxBytes = 0;
+};
+
+// In-memory LRU cache of answers, keyed by the whole request (endpoint + JSON body: model, options, system text, prompt...)
+// The least recently used answers are dropped when the stored keys + answers exceed the byte budget.
+class ResponseCache
+{
+public:
+	explicit ResponseCache(size_t maxBytes = 0) : _maxBytes(maxBytes) {};
+
+	// 0: disabled (and emptied)
+	void setMaxBytes(size_t maxBytes);
+	bool isEnabled() const;
+
+	bool get(const std::string& key, CachedResponse& cachedResponse);
+	void put(const std::string& key, const CachedResponse& cachedResponse);
+	void countBypassed();
+	void clear();
+
+	ResponseCacheStats stats() const;
+
+protected:
+	struct Entry
+	{
+		uint64_t hash;
+		std::string key; // Compared on lookup: no false hits on hash collisions
+		CachedResponse value;
+		size_t bytes() const { return key.size() + value.response.size() + value.context.size() * sizeof(int) + sizeof(Entry); };
+	};
+
+	void evict(size_t maxBytes);
+
+	mutable std::mutex _mutex;
+	std::list<Entry> _entries;                                      // Most recently used first
+	std::unordered_map<uint64_t, std::list<Entry>::iterator> _index; // By hash
+	size_t _maxBytes;
+	size_t _bytes = 0;
+	ResponseCacheStats _stats;
+};
+
+
+#endif // PLUGINNPPOPENAI_RESPONSECACHE_H
@@ -0,0 +1,149 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "ScintillaSink.h"
+#include <chrono>
+
+// Writes at least this big take the fast path
+#define SCINTILLASINK_LARGE_WRITE  (32 * 1024)
+
+// Min. growth of the document buffer
+#define SCINTILLASINK_ALLOCATE_STEP (64 * 1024)
+
+ScintillaSinkStats ScintillaSink::_stats;
+
+// Target: [start, end) of the document shown in `scintilla`
+bool ScintillaSink::attach(const NppData& nppData, HWND scintilla, UINT_PTR bufferID, size_t start, size_t end, bool isReplaceTarget)
+{
+	_mainView = nppData._scintillaMainHandle;
+	_secondView = nppData._scintillaSecondHandle;
+	_isReplaceTarget = isReplaceTarget;
+	_hasWritten = false;
+	_allocated = 0;
+	return _anchor.attach(nppData, scintilla, bufferID, start, end);
+}
+
+// Write the next part of the answer
+bool ScintillaSink::write(const std::string& text)
+{
+	if (text.empty() || !_anchor.isDocumentOpen())
+	{
+		return false;
+	}
+	HWND view = _anchor.getView();
+	if (!view)
+	{
+		return false;
+	}
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	// One undo step without an open undo action: Scintilla merges an insertion directly after the previous one into its step,
+	// so the fragments of the answer add up, while an edit of the user in between starts a new step (and theirs are never undone with the answer).
+	// The first write starts a new step (not merged with the user's typing right before the target).
+	size_t length = (size_t)::SendMessage(view, SCI_GETLENGTH, 0, 0);
+	if (!_hasWritten || length != _expectedLength)
+	{
+		_stats.undoGroups++;
+	}
+	if (!_hasWritten)
+	{
+		endUndoStep(view);
+	}
+
+	// Grow the document buffer in big steps (it would be reallocated + moved again and again by small fragments)
+	std::string separatedText;
+	const std::string* writtenText = &text;
+	if (!_hasWritten && !_isReplaceTarget)
+	{
+		separatedText = "\n\n" + text;
+		writtenText = &separatedText;
+	}
+	if (length + writtenText->length() > _allocated)
+	{
+		size_t step = writtenText->length() * 2;
+		_allocated = length + ((step > SCINTILLASINK_ALLOCATE_STEP) ? step : SCINTILLASINK_ALLOCATE_STEP);
+		::SendMessage(view, SCI_ALLOCATE, _allocated, 0);
+	}
+
+	// Fast path for large writes: no redraw of the visible views until the whole text is in
+	bool isLargeWrite = writtenText->length() >= SCINTILLASINK_LARGE_WRITE;
+	if (isLargeWrite)
+	{
+		setRedraw(false);
+		_stats.largeWrites++;
+	}
+
+	// Replacing the question (deletion + insertion) is a step of its own, the rest of the answer is merged into the next one
+	bool isWritten;
+	if (!_hasWritten && _isReplaceTarget)
+	{
+		::SendMessage(view, SCI_BEGINUNDOACTION, 0, 0);
+		isWritten = _anchor.replace(*writtenText);
+		::SendMessage(view, SCI_ENDUNDOACTION, 0, 0);
+	}
+	else
+	{
+		isWritten = _anchor.append(*writtenText);
+	}
+	_hasWritten = _hasWritten || isWritten;
+	_expectedLength = (size_t)::SendMessage(view, SCI_GETLENGTH, 0, 0);
+
+	if (isLargeWrite)
+	{
+		setRedraw(true);
+	}
+
+	_stats.writes++;
+	_stats.bytes += writtenText->length();
+	_stats.microseconds += (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+	return isWritten;
+}
+
+// End of the answer: end the undo step (the user's typing at its end is not merged into it), release the document
+void ScintillaSink::finish()
+{
+	HWND view = _anchor.getView();
+	if (view && _hasWritten)
+	{
+		endUndoStep(view);
+	}
+	_anchor.detach();
+}
+
+// An empty undo action: the next insertion is not merged into the last undo step
+void ScintillaSink::endUndoStep(HWND view)
+{
+	::SendMessage(view, SCI_BEGINUNDOACTION, 0, 0);
+	::SendMessage(view, SCI_ENDUNDOACTION, 0, 0);
+}
+
+// Suspend/resume painting of the visible views showing the document
+void ScintillaSink::setRedraw(bool isRedraw)
+{
+	HWND views[] = { _mainView, _secondView };
+	for (HWND visibleView : views)
+	{
+		if (visibleView && _anchor.isShownIn(visibleView))
+		{
+			::SendMessage(visibleView, WM_SETREDRAW, isRedraw ? TRUE : FALSE, 0);
+			if (isRedraw)
+			{
+				::InvalidateRect(visibleView, NULL, TRUE);
+			}
+		}
+	}
+}
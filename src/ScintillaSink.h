@@ -0,0 +1,76 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#ifndef PLUGINNPPOPENAI_SCINTILLASINK_H
+#define PLUGINNPPOPENAI_SCINTILLASINK_H
+
+#include "ResponseAnchor.h"
+#include <string>
+
+// Insertion cost of all answers (UI thread)
+struct ScintillaSinkStats
+{
+	unsigned long long writes      = 0;
+	unsigned long long bytes       = 0;
+	unsigned long long microseconds = 0;
+	unsigned long long largeWrites = 0; // Fast path
+	unsigned long long undoGroups  = 0; // Undo steps: one per answer, unless the user edited the document meanwhile
+};
+
+// Writes an answer (streamed or not) into the document at its anchored position (UI thread):
+// - the whole generation is one undo step (a new one starts if the user edits the document meanwhile), no undo action is left open between two writes
+// - the document buffer grows in big steps instead of at every fragment
+// - large writes (fast path): the buffer is allocated once and the views showing the document aren't redrawn until the text is in
+class ScintillaSink
+{
+public:
+	ScintillaSink() = default;
+	ScintillaSink(const ScintillaSink&) = delete;
+	ScintillaSink& operator=(const ScintillaSink&) = delete;
+
+	// Target: [start, end) of the document shown in `scintilla`.
+	// `isReplaceTarget`: the first write replaces the target, otherwise the answer is added after it (after an empty line).
+	bool attach(const NppData& nppData, HWND scintilla, UINT_PTR bufferID, size_t start, size_t end, bool isReplaceTarget);
+
+	// Write the next part of the answer
+	bool write(const std::string& text);
+
+	// End of the answer: end the undo step, release the document
+	void finish();
+
+	bool hasWritten() const { return _hasWritten; };
+	bool isDocumentOpen() const { return _anchor.isDocumentOpen(); };
+
+	static ScintillaSinkStats stats() { return _stats; };
+
+protected:
+	void setRedraw(bool isRedraw);
+	static void endUndoStep(HWND view);
+
+	ResponseAnchor _anchor;
+	HWND _mainView = nullptr;
+	HWND _secondView = nullptr;
+	bool _isReplaceTarget = false;
+	bool _hasWritten = false;
+	size_t _expectedLength = 0; // Document length after our last write (changed: the user edited the document)
+	size_t _allocated = 0;      // Requested with `SCI_ALLOCATE`
+
+	static ScintillaSinkStats _stats;
+};
+
+
+#endif // PLUGINNPPOPENAI_SCINTILLASINK_H
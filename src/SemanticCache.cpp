@@ -0,0 +1,187 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#include "SemanticCache.h"
+#include <chrono>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SEMANTICCACHE_SSE2
+#endif
+
+// Dot product of two float vectors (SSE2 if available); the cosine similarity of normalized vectors
+float dotProduct(const float* a, const float* b, size_t length)
+{
+	size_t i = 0;
+	float sum = 0.0f;
+#ifdef SEMANTICCACHE_SSE2
+	// 2 x 4 lanes: independent additions, not limited by the latency of one accumulator
+	__m128 sum0 = _mm_setzero_ps();
+	__m128 sum1 = _mm_setzero_ps();
+	for (; i + 8 <= length; i += 8)
+	{
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+	}
+	float lanes[4];
+	_mm_storeu_ps(lanes, _mm_add_ps(sum0, sum1));
+	sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+	for (; i < length; i++)
+	{
+		sum += a[i] * b[i];
+	}
+	return sum;
+}
+
+// 0: disabled (and emptied)
+void SemanticCache::setMaxEntries(size_t maxEntries)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (maxEntries < _entries.size())
+	{
+		_entries.clear();
+		_vectors.clear();
+		_next = 0;
+	}
+	_maxEntries = maxEntries;
+}
+
+bool SemanticCache::isEnabled() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _maxEntries > 0;
+}
+
+bool SemanticCache::find(uint64_t scope, std::vector<float> embedding, float threshold, CachedResponse& cachedResponse, float& similarity)
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	similarity = 0.0f;
+	bool isNormalized = normalize(embedding);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	size_t bestEntry = _entries.size();
+	if (isNormalized && embedding.size() == _dimension)
+	{
+		for (size_t i = 0; i < _entries.size(); i++)
+		{
+			if (_entries[i].scope != scope)
+			{
+				continue;
+			}
+			float entrySimilarity = dotProduct(&_vectors[i * _dimension], &embedding[0], _dimension);
+			if (entrySimilarity >= threshold && entrySimilarity > similarity)
+			{
+				similarity = entrySimilarity;
+				bestEntry = i;
+			}
+		}
+	}
+
+	_stats.searchMicroseconds += (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+	if (bestEntry == _entries.size())
+	{
+		return false;
+	}
+	cachedResponse = _entries[bestEntry].value;
+	_stats.hits++;
+	return true;
+}
+
+void SemanticCache::put(uint64_t scope, std::vector<float> embedding, const CachedResponse& cachedResponse)
+{
+	if (!normalize(embedding))
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_maxEntries == 0)
+	{
+		return;
+	}
+	if (embedding.size() != _dimension)
+	{
+		// Another embedding model: the stored vectors can't be compared
+		_entries.clear();
+		_vectors.clear();
+		_next = 0;
+		_dimension = embedding.size();
+	}
+
+	Entry entry{ scope, cachedResponse };
+	if (_entries.size() < _maxEntries)
+	{
+		_entries.push_back(std::move(entry));
+		_vectors.insert(_vectors.end(), embedding.begin(), embedding.end());
+		return;
+	}
+	_next %= _entries.size();
+	_entries[_next] = std::move(entry);
+	std::copy(embedding.begin(), embedding.end(), _vectors.begin() + _next * _dimension);
+	_next++;
+}
+
+void SemanticCache::clear()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_entries.clear();
+	_vectors.clear();
+	_next = 0;
+}
+
+// Counted by the caller, which gets the embedding from Ollama
+void SemanticCache::countLookup(bool isEmbedded, unsigned long long microseconds)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_stats.lookups++;
+	if (!isEmbedded)
+	{
+		_stats.embedErrors++;
+	}
+	_stats.lookupMicroseconds += microseconds;
+}
+
+SemanticCacheStats SemanticCache::stats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	SemanticCacheStats stats = _stats;
+	stats.entries = _entries.size();
+	stats.dimension = _dimension;
+	return stats;
+}
+
+// Unit length: the dot product is the cosine similarity (`false` for an empty/zero vector)
+bool SemanticCache::normalize(std::vector<float>& vector)
+{
+	if (vector.empty())
+	{
+		return false;
+	}
+	float length = std::sqrt(dotProduct(&vector[0], &vector[0], vector.size()));
+	if (!(length > 0.0f))
+	{
+		return false;
+	}
+	for (float& value : vector)
+	{
+		value /= length;
+	}
+	return true;
+}
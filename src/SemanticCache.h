@@ -0,0 +1,78 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#ifndef PLUGINNPPOPENAI_SEMANTICCACHE_H
+#define PLUGINNPPOPENAI_SEMANTICCACHE_H
+
+#include "ResponseCache.h"
+
+// Dot product of two float vectors (SSE2 if available); the cosine similarity of normalized vectors
+float dotProduct(const float* a, const float* b, size_t length);
+
+struct SemanticCacheStats
+{
+	unsigned long long lookups         = 0;
+	unsigned long long hits            = 0;
+	unsigned long long embedErrors     = 0; // E.g. the embedding model is not pulled: asked Ollama without a lookup
+	unsigned long long lookupMicroseconds = 0; // Embedding + search
+	unsigned long long searchMicroseconds = 0;
+	size_t entries   = 0;
+	size_t dimension = 0;
+};
+
+// Answers of similar questions: the embedding of every cached question is compared to the new one (cosine similarity),
+// the closest one above the threshold is a hit. Only questions of the same scope (model, options, system text...) are compared.
+// The vectors are normalized and stored in one contiguous array, so a lookup is a linear scan of dot products.
+class SemanticCache
+{
+public:
+	explicit SemanticCache(size_t maxEntries = 0) : _maxEntries(maxEntries) {};
+
+	// 0: disabled (and emptied)
+	void setMaxEntries(size_t maxEntries);
+	bool isEnabled() const;
+
+	bool find(uint64_t scope, std::vector<float> embedding, float threshold, CachedResponse& cachedResponse, float& similarity);
+	void put(uint64_t scope, std::vector<float> embedding, const CachedResponse& cachedResponse);
+	void clear();
+
+	// Counted by the caller, which gets the embedding from Ollama
+	void countLookup(bool isEmbedded, unsigned long long microseconds);
+
+	SemanticCacheStats stats() const;
+
+protected:
+	struct Entry
+	{
+		uint64_t scope;
+		CachedResponse value;
+	};
+
+	static bool normalize(std::vector<float>& vector);
+
+	mutable std::mutex _mutex;
+	std::vector<Entry> _entries;  // Ring: the oldest one is replaced when full
+	std::vector<float> _vectors;  // Row `i` (`_dimension` floats) is the embedding of `_entries[i]`
+	size_t _dimension = 0;        // Set by the first embedding (another model: the cache starts over)
+	size_t _next = 0;
+	size_t _maxEntries;
+	SemanticCacheStats _stats;
+};
+
+
+#endif // PLUGINNPPOPENAI_SEMANTICCACHE_H
@@ -0,0 +1,191 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "UiDispatcher.h"
+
+#define UIDISPATCHER_CLASS_NAME TEXT("NppOllamaUiDispatcher")
+#define UIDISPATCHER_WAKEUP     (WM_APP + 1)
+#define UIDISPATCHER_TIMER_ID   1
+#define UIDISPATCHER_FRAME_MS   16
+
+UiDispatcher::~UiDispatcher()
+{
+	deleteNodes(_head.exchange(nullptr));
+}
+
+// Create the message window (UI thread)
+bool UiDispatcher::create(HINSTANCE hInstance)
+{
+	if (_hWnd)
+	{
+		return true;
+	}
+	_hInstance = hInstance;
+
+	WNDCLASSEX windowClass = {};
+	windowClass.cbSize = sizeof(windowClass);
+	windowClass.lpfnWndProc = windowProc;
+	windowClass.hInstance = hInstance;
+	windowClass.lpszClassName = UIDISPATCHER_CLASS_NAME;
+	::RegisterClassEx(&windowClass); // Fails if already registered (e.g. after `destroy()`), that's fine
+
+	_hWnd = ::CreateWindowEx(0, UIDISPATCHER_CLASS_NAME, TEXT(""), 0, 0, 0, 0, 0, HWND_MESSAGE, NULL, hInstance, NULL);
+	if (!_hWnd)
+	{
+		return false;
+	}
+	::SetWindowLongPtr(_hWnd, GWLP_USERDATA, (LONG_PTR)this);
+
+	// Tasks posted before the window existed
+	if (_head.load() && !_isWakeUpPosted.exchange(true))
+	{
+		::PostMessage(_hWnd, UIDISPATCHER_WAKEUP, 0, 0);
+	}
+	return true;
+}
+
+// Destroy the message window, queued tasks are dropped (UI thread, after the workers are stopped)
+void UiDispatcher::destroy()
+{
+	if (_hWnd)
+	{
+		::DestroyWindow(_hWnd);
+		_hWnd = nullptr;
+		::UnregisterClass(UIDISPATCHER_CLASS_NAME, _hInstance);
+	}
+	_isTimerSet = false;
+	_batch.clear();
+	deleteNodes(_head.exchange(nullptr));
+}
+
+// Queue a task (any thread)
+void UiDispatcher::post(Task task)
+{
+	Node* node = new Node{ std::move(task), _head.load() };
+	while (!_head.compare_exchange_weak(node->next, node))
+	{
+	}
+
+	// Wake up the UI thread once per batch
+	if (!_isWakeUpPosted.exchange(true) && _hWnd)
+	{
+		::PostMessage(_hWnd, UIDISPATCHER_WAKEUP, 0, 0);
+	}
+}
+
+LRESULT CALLBACK UiDispatcher::windowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+	UiDispatcher* dispatcher = (UiDispatcher*)::GetWindowLongPtr(hWnd, GWLP_USERDATA);
+	if (dispatcher)
+	{
+		switch (message)
+		{
+		case UIDISPATCHER_WAKEUP:
+			dispatcher->onWakeUp();
+			return 0;
+
+		case WM_TIMER:
+			if (wParam == UIDISPATCHER_TIMER_ID)
+			{
+				::KillTimer(hWnd, UIDISPATCHER_TIMER_ID);
+				dispatcher->_isTimerSet = false;
+				dispatcher->runTasks();
+				return 0;
+			}
+			break;
+		}
+	}
+	return ::DefWindowProc(hWnd, message, wParam, lParam);
+}
+
+// Run the tasks now, or at the next frame if the last batch was less than 16 ms ago
+void UiDispatcher::onWakeUp()
+{
+	ULONGLONG elapsed = ::GetTickCount64() - _lastRunTick;
+	if (elapsed >= UIDISPATCHER_FRAME_MS)
+	{
+		runTasks();
+	}
+	else if (!_isTimerSet)
+	{
+		_isTimerSet = (::SetTimer(_hWnd, UIDISPATCHER_TIMER_ID, (UINT)(UIDISPATCHER_FRAME_MS - elapsed), NULL) != 0);
+		if (!_isTimerSet)
+		{
+			runTasks();
+		}
+	}
+}
+
+// Take every queued task (in posting order) and run them
+void UiDispatcher::runTasks()
+{
+	_lastRunTick = ::GetTickCount64();
+
+	// Posts from now on need a new wake-up
+	_isWakeUpPosted = false;
+	Node* node = _head.exchange(nullptr);
+
+	// Reverse the stack: oldest first
+	Node* oldest = nullptr;
+	while (node)
+	{
+		Node* next = node->next;
+		node->next = oldest;
+		oldest = node;
+		node = next;
+	}
+
+	unsigned long long batchSize = 0;
+	while (oldest)
+	{
+		Node* next = oldest->next;
+		_batch.push_back(std::move(oldest->task));
+		delete oldest;
+		oldest = next;
+		batchSize++;
+	}
+	if (batchSize > 0)
+	{
+		_stats.tasks += batchSize;
+		_stats.batches++;
+		if (batchSize > _stats.maxBatch)
+		{
+			_stats.maxBatch = batchSize;
+		}
+	}
+
+	// A task may run a message loop (e.g. `MessageBox()`) calling `runTasks()` again: it continues with the same batch, keeping the order
+	while (!_batch.empty())
+	{
+		Task task = std::move(_batch.front());
+		_batch.pop_front();
+		if (task)
+		{
+			task();
+		}
+	}
+}
+
+void UiDispatcher::deleteNodes(Node* node)
+{
+	while (node)
+	{
+		Node* next = node->next;
+		delete node;
+		node = next;
+	}
+}
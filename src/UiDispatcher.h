@@ -0,0 +1,81 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#ifndef PLUGINNPPOPENAI_UIDISPATCHER_H
+#define PLUGINNPPOPENAI_UIDISPATCHER_H
+
+#include <windows.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+
+// Statistics (UI thread)
+struct UiDispatcherStats
+{
+	unsigned long long tasks    = 0;
+	unsigned long long batches  = 0;
+	unsigned long long maxBatch = 0;
+};
+
+// Run tasks of other threads (e.g. the request engine) on the UI thread:
+// `post()` pushes to a lock-free queue, a hidden message window executes them in batches, at most once per frame (16 ms).
+// Worker threads never touch a window directly, so they can't block on (or deadlock with) the UI thread.
+class UiDispatcher
+{
+public:
+	typedef std::function<void()> Task;
+
+	UiDispatcher() = default;
+	~UiDispatcher();
+	UiDispatcher(const UiDispatcher&) = delete;
+	UiDispatcher& operator=(const UiDispatcher&) = delete;
+
+	// Create the message window (UI thread)
+	bool create(HINSTANCE hInstance);
+
+	// Destroy the message window, queued tasks are dropped (UI thread, after the workers are stopped)
+	void destroy();
+
+	// Queue a task (any thread)
+	void post(Task task);
+
+	UiDispatcherStats stats() const { return _stats; };
+
+protected:
+	struct Node
+	{
+		Task task;
+		Node* next;
+	};
+
+	static LRESULT CALLBACK windowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
+	void onWakeUp();
+	void runTasks();
+	void deleteNodes(Node* node);
+
+	HWND _hWnd = nullptr;
+	HINSTANCE _hInstance = nullptr;
+	std::atomic<Node*> _head{ nullptr };    // Newest first (lock-free stack, reversed when taken)
+	std::atomic<bool> _isWakeUpPosted{ false };
+	bool _isTimerSet = false;
+	ULONGLONG _lastRunTick = 0;
+	std::deque<Task> _batch;                // Taken tasks, also continued by nested message loops (e.g. `MessageBox()`)
+	UiDispatcherStats _stats;
+};
+
+
+#endif // PLUGINNPPOPENAI_UIDISPATCHER_H
@@ -0,0 +1,372 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#include "Utf8Convert.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define UTF8CONVERT_SSE2
+#endif
+
+#define UTF8CONVERT_REPLACEMENT 0xFFFD
+#define UTF8CONVERT_REPLACEMENT_UTF8 "\xEF\xBF\xBD"
+
+// Decode the multi-byte sequence at `data` (lead byte >= 0x80, `data < end`) into `codePoint` + its length.
+// Invalid: returns `false`, `codePoint` is U+FFFD and `sequenceLength` the length of the invalid part;
+// `isIncomplete`: valid so far, but cut by `end`.
+static inline bool decodeSequence(const unsigned char* data, const unsigned char* end, uint32_t& codePoint, size_t& sequenceLength, bool& isIncomplete)
+{
+	unsigned char lead = data[0];
+	size_t trailCount;
+	unsigned char low = 0x80; // Valid range of the first trail byte (no overlong forms, surrogates or > U+10FFFF)
+	unsigned char high = 0xBF;
+	isIncomplete = false;
+	if (lead >= 0xC2 && lead <= 0xDF)
+	{
+		trailCount = 1;
+		codePoint = lead & 0x1F;
+	}
+	else if (lead >= 0xE0 && lead <= 0xEF)
+	{
+		trailCount = 2;
+		codePoint = lead & 0x0F;
+		low = (lead == 0xE0) ? 0xA0 : 0x80;
+		high = (lead == 0xED) ? 0x9F : 0xBF;
+	}
+	else if (lead >= 0xF0 && lead <= 0xF4)
+	{
+		trailCount = 3;
+		codePoint = lead & 0x07;
+		low = (lead == 0xF0) ? 0x90 : 0x80;
+		high = (lead == 0xF4) ? 0x8F : 0xBF;
+	}
+	else
+	{
+		codePoint = UTF8CONVERT_REPLACEMENT;
+		sequenceLength = 1; // Trail byte or invalid lead byte
+		return false;
+	}
+
+	size_t i = 1;
+	for (; i <= trailCount; i++)
+	{
+		if (data + i >= end)
+		{
+			isIncomplete = true;
+			codePoint = UTF8CONVERT_REPLACEMENT;
+			sequenceLength = i;
+			return false;
+		}
+		unsigned char trail = data[i];
+		if (trail < low || trail > high)
+		{
+			codePoint = UTF8CONVERT_REPLACEMENT;
+			sequenceLength = i; // Maximal invalid subpart: the next byte starts a new sequence
+			return false;
+		}
+		low = 0x80;
+		high = 0xBF;
+		codePoint = (codePoint << 6) | (trail & 0x3F);
+	}
+	sequenceLength = i;
+	return true;
+}
+
+// UTF-8 -> UTF-16 into `out` (room for `length` units); returns the written units
+template<class Unit>
+size_t convertUtf8ToUtf16(const char* data, size_t length, Unit* out, size_t* incompleteLength)
+{
+	static_assert(sizeof(Unit) == 2, "UTF-16 code unit");
+	const unsigned char* input = (const unsigned char*)data;
+	const unsigned char* end = input + length;
+	Unit* output = out;
+	while (input < end)
+	{
+#ifdef UTF8CONVERT_SSE2
+		// ASCII: 16 bytes -> 16 units (zero-extended)
+		const __m128i zero = _mm_setzero_si128();
+		while (end - input >= 16)
+		{
+			__m128i bytes = _mm_loadu_si128((const __m128i*)input);
+			if (_mm_movemask_epi8(bytes) != 0)
+			{
+				break;
+			}
+			_mm_storeu_si128((__m128i*)output, _mm_unpacklo_epi8(bytes, zero));
+			_mm_storeu_si128((__m128i*)(output + 8), _mm_unpackhi_epi8(bytes, zero));
+			input += 16;
+			output += 16;
+		}
+		if (input == end)
+		{
+			break;
+		}
+#endif
+		if (*input < 0x80)
+		{
+			*output++ = (Unit)*input++;
+			continue;
+		}
+
+		uint32_t codePoint;
+		size_t sequenceLength;
+		bool isIncomplete;
+		decodeSequence(input, end, codePoint, sequenceLength, isIncomplete);
+		if (isIncomplete && incompleteLength)
+		{
+			*incompleteLength = (size_t)(end - input);
+			return (size_t)(output - out);
+		}
+		input += sequenceLength;
+		if (codePoint >= 0x10000)
+		{
+			codePoint -= 0x10000;
+			*output++ = (Unit)(0xD800 + (codePoint >> 10));
+			*output++ = (Unit)(0xDC00 + (codePoint & 0x3FF));
+		}
+		else
+		{
+			*output++ = (Unit)codePoint;
+		}
+	}
+	if (incompleteLength)
+	{
+		*incompleteLength = 0;
+	}
+	return (size_t)(output - out);
+}
+
+// UTF-16 -> UTF-8 into `out` (room for 3 * `length` bytes); returns the written bytes
+template<class Unit>
+size_t convertUtf16ToUtf8(const Unit* data, size_t length, char* out)
+{
+	static_assert(sizeof(Unit) == 2, "UTF-16 code unit");
+	const Unit* input = data;
+	const Unit* end = data + length;
+	unsigned char* output = (unsigned char*)out;
+	while (input < end)
+	{
+#ifdef UTF8CONVERT_SSE2
+		// ASCII: 8 units -> 8 bytes
+		const __m128i nonASCIIMask = _mm_set1_epi16((short)0xFF80);
+		const __m128i zero = _mm_setzero_si128();
+		while (end - input >= 8)
+		{
+			__m128i units = _mm_loadu_si128((const __m128i*)input);
+			if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(units, nonASCIIMask), zero)) != 0xFFFF)
+			{
+				break;
+			}
+			_mm_storel_epi64((__m128i*)output, _mm_packus_epi16(units, units));
+			input += 8;
+			output += 8;
+		}
+		if (input == end)
+		{
+			break;
+		}
+#endif
+		uint32_t codePoint = (uint16_t)*input++;
+		if (codePoint < 0x80)
+		{
+			*output++ = (unsigned char)codePoint;
+			continue;
+		}
+		if (codePoint < 0x800)
+		{
+			*output++ = (unsigned char)(0xC0 | (codePoint >> 6));
+			*output++ = (unsigned char)(0x80 | (codePoint & 0x3F));
+			continue;
+		}
+		if (codePoint >= 0xD800 && codePoint <= 0xDFFF)
+		{
+			uint32_t lowSurrogate = (input < end) ? (uint16_t)*input : 0;
+			if (codePoint <= 0xDBFF && lowSurrogate >= 0xDC00 && lowSurrogate <= 0xDFFF)
+			{
+				input++;
+				codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+				*output++ = (unsigned char)(0xF0 | (codePoint >> 18));
+				*output++ = (unsigned char)(0x80 | ((codePoint >> 12) & 0x3F));
+				*output++ = (unsigned char)(0x80 | ((codePoint >> 6) & 0x3F));
+				*output++ = (unsigned char)(0x80 | (codePoint & 0x3F));
+				continue;
+			}
+			codePoint = UTF8CONVERT_REPLACEMENT; // Unpaired surrogate
+		}
+		*output++ = (unsigned char)(0xE0 | (codePoint >> 12));
+		*output++ = (unsigned char)(0x80 | ((codePoint >> 6) & 0x3F));
+		*output++ = (unsigned char)(0x80 | (codePoint & 0x3F));
+	}
+	return (size_t)(output - (unsigned char*)out);
+}
+
+// Well-formed UTF-8 (a sequence cut at the end is invalid too)
+bool isValidUtf8(const char* data, size_t length)
+{
+	const unsigned char* input = (const unsigned char*)data;
+	const unsigned char* end = input + length;
+	while (input < end)
+	{
+#ifdef UTF8CONVERT_SSE2
+		while (end - input >= 16 && _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)input)) == 0)
+		{
+			input += 16;
+		}
+		if (input == end)
+		{
+			break;
+		}
+#endif
+		if (*input < 0x80)
+		{
+			input++;
+			continue;
+		}
+		uint32_t codePoint;
+		size_t sequenceLength;
+		bool isIncomplete;
+		if (!decodeSequence(input, end, codePoint, sequenceLength, isIncomplete))
+		{
+			return false;
+		}
+		input += sequenceLength;
+	}
+	return true;
+}
+
+// Streamed UTF-8: complete the carried sequence first, then pass on the complete code points of `data`
+void Utf8StreamDecoder::decode(const char* data, size_t length, std::string& out)
+{
+	if (_pendingLength > 0 && length > 0)
+	{
+		// The carried bytes are a valid prefix: the sequence is decided within its max. 4 bytes
+		unsigned char sequence[4];
+		size_t taken = (length < 4 - _pendingLength) ? length : 4 - _pendingLength;
+		memcpy(sequence, _pending, _pendingLength);
+		memcpy(sequence + _pendingLength, data, taken);
+
+		uint32_t codePoint;
+		size_t sequenceLength;
+		bool isIncomplete;
+		bool isValid = decodeSequence(sequence, sequence + _pendingLength + taken, codePoint, sequenceLength, isIncomplete);
+		if (isIncomplete)
+		{
+			memcpy(_pending + _pendingLength, data, taken); // Still cut (e.g. 1 byte per call)
+			_pendingLength += taken;
+			return;
+		}
+		if (isValid)
+		{
+			out.append((const char*)sequence, sequenceLength);
+		}
+		else
+		{
+			out += UTF8CONVERT_REPLACEMENT_UTF8;
+		}
+		size_t consumed = sequenceLength - _pendingLength; // The invalid part includes every carried byte
+		data += consumed;
+		length -= consumed;
+		_pendingLength = 0;
+	}
+	decodeComplete(data, length, out);
+}
+
+// End of the stream: a carried incomplete sequence becomes U+FFFD
+void Utf8StreamDecoder::finish(std::string& out)
+{
+	if (_pendingLength > 0)
+	{
+		out += UTF8CONVERT_REPLACEMENT_UTF8;
+		_pendingLength = 0;
+	}
+}
+
+// Copy the valid runs of `data` at once, replace the invalid parts, carry a cut sequence at the end
+void Utf8StreamDecoder::decodeComplete(const char* data, size_t length, std::string& out)
+{
+	const unsigned char* input = (const unsigned char*)data;
+	const unsigned char* end = input + length;
+	const unsigned char* run = input; // Valid bytes not copied yet
+	while (input < end)
+	{
+#ifdef UTF8CONVERT_SSE2
+		while (end - input >= 16 && _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)input)) == 0)
+		{
+			input += 16;
+		}
+		if (input == end)
+		{
+			break;
+		}
+#endif
+		if (*input < 0x80)
+		{
+			input++;
+			continue;
+		}
+		uint32_t codePoint;
+		size_t sequenceLength;
+		bool isIncomplete;
+		if (decodeSequence(input, end, codePoint, sequenceLength, isIncomplete))
+		{
+			input += sequenceLength;
+			continue;
+		}
+		out.append((const char*)run, (size_t)(input - run));
+		if (isIncomplete)
+		{
+			memcpy(_pending, input, sequenceLength);
+			_pendingLength = sequenceLength;
+			return;
+		}
+		out += UTF8CONVERT_REPLACEMENT_UTF8;
+		input += sequenceLength;
+		run = input;
+	}
+	out.append((const char*)run, (size_t)(end - run));
+}
+
+template size_t convertUtf8ToUtf16<char16_t>(const char* data, size_t length, char16_t* out, size_t* incompleteLength);
+template size_t convertUtf16ToUtf8<char16_t>(const char16_t* data, size_t length, char* out);
+
+#if WCHAR_MAX == 0xFFFF
+template size_t convertUtf8ToUtf16<wchar_t>(const char* data, size_t length, wchar_t* out, size_t* incompleteLength);
+template size_t convertUtf16ToUtf8<wchar_t>(const wchar_t* data, size_t length, char* out);
+
+std::wstring utf8ToWide(const char* data, size_t length)
+{
+	std::wstring wideText(length, L'\0');
+	if (length > 0)
+	{
+		wideText.resize(convertUtf8ToUtf16(data, length, &wideText[0]));
+	}
+	return wideText;
+}
+
+std::string wideToUtf8(const wchar_t* data, size_t length)
+{
+	std::string text(length * 3, '\0');
+	if (length > 0)
+	{
+		text.resize(convertUtf16ToUtf8(data, length, &text[0]));
+	}
+	return text;
+}
+#endif
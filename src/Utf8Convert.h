@@ -0,0 +1,72 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#ifndef PLUGINNPPOPENAI_UTF8CONVERT_H
+#define PLUGINNPPOPENAI_UTF8CONVERT_H
+
+#include <cstddef>
+#include <cwchar>
+#include <string>
+
+// Validated UTF-8 <-> UTF-16 conversion: ASCII runs are converted 16 (8) code units at a time (SSE2), the rest one code point at a time.
+// Invalid input never fails: ill-formed UTF-8 (overlong, surrogates, > U+10FFFF, stray bytes) and unpaired surrogates become U+FFFD,
+// one per maximal invalid subpart (like `MultiByteToWideChar()`, browsers...).
+// `Unit` is a 16-bit code unit type (`char16_t`, or `wchar_t` on Windows).
+
+// UTF-8 -> UTF-16 into `out` (room for `length` units); returns the written units.
+// `incompleteLength` (streaming): a sequence cut at the end of `data` is not converted, its length is stored here so that it can be
+// passed again with the next bytes. Null: it becomes U+FFFD.
+template<class Unit>
+size_t convertUtf8ToUtf16(const char* data, size_t length, Unit* out, size_t* incompleteLength = nullptr);
+
+// UTF-16 -> UTF-8 into `out` (room for 3 * `length` bytes); returns the written bytes
+template<class Unit>
+size_t convertUtf16ToUtf8(const Unit* data, size_t length, char* out);
+
+// Well-formed UTF-8 (a sequence cut at the end is invalid too)
+bool isValidUtf8(const char* data, size_t length);
+
+// Streamed UTF-8 (e.g. answer fragments): a sequence split between two `decode()` calls is carried over (max. 3 bytes, no allocation),
+// only complete code points are appended to the output; ill-formed bytes become U+FFFD
+class Utf8StreamDecoder
+{
+public:
+	void decode(const char* data, size_t length, std::string& out);
+
+	// End of the stream: a carried incomplete sequence becomes U+FFFD
+	void finish(std::string& out);
+
+	size_t pendingLength() const { return _pendingLength; };
+
+protected:
+	void decodeComplete(const char* data, size_t length, std::string& out);
+
+	char _pending[4] = { 0, };
+	size_t _pendingLength = 0;
+};
+
+#if WCHAR_MAX == 0xFFFF
+// Whole strings: `wchar_t` is UTF-16 (Windows)
+std::wstring utf8ToWide(const char* data, size_t length);
+inline std::wstring utf8ToWide(const std::string& text) { return utf8ToWide(text.data(), text.size()); };
+std::string wideToUtf8(const wchar_t* data, size_t length);
+inline std::string wideToUtf8(const std::wstring& text) { return wideToUtf8(text.data(), text.size()); };
+#endif
+
+
+#endif // PLUGINNPPOPENAI_UTF8CONVERT_H
@@ -0,0 +1,237 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+// Chunker: always advances, cuts between characters; job: bounded parallelism, answers in order, reduce pass, cancel
+#include "ChunkedJob.h"
+#include "TestCheck.h"
+#include <atomic>
+#include <condition_variable>
+#include <random>
+#include <thread>
+
+static bool isCharacterBoundary(const std::string& text, size_t pos)
+{
+	return pos == 0 || pos >= text.size() || ((unsigned char)text[pos] & 0xC0) != 0x80;
+}
+
+// Random text of ASCII, 2-4 byte characters and line ends
+static std::string makeText(std::mt19937& random, size_t length)
+{
+	static const char* pieces[] = { "a", "b", " ", "\n", "\xC3\xA1", "\xC5\x91", "\xE6\xBC\xA2", "\xE2\x82\xAC", "\xF0\x9F\x98\x80" };
+	std::string text;
+	while (text.size() < length)
+	{
+		text += pieces[random() % (sizeof(pieces) / sizeof(pieces[0]))];
+	}
+	return text;
+}
+
+static void checkChunks(const std::string& text, size_t chunkSize, size_t overlap)
+{
+	std::vector<TextChunk> chunks = splitTextIntoChunks(text, chunkSize, overlap);
+	if (!CHECK(chunks.size() <= text.size()))
+	{
+		return;
+	}
+	size_t pos = 0;
+	size_t badEnds = 0;
+	size_t oversized = 0;
+	for (const TextChunk& chunk : chunks)
+	{
+		CHECK(chunk.begin <= pos && chunk.end > pos); // Overlap, then new text
+		badEnds += (isCharacterBoundary(text, chunk.begin) && isCharacterBoundary(text, chunk.end)) ? 0 : 1;
+		oversized += (chunk.end - chunk.begin > chunkSize) ? 1 : 0;
+		pos = chunk.end;
+	}
+	CHECK(pos == text.size());
+	CHECK(badEnds == 0);
+	if (chunkSize >= 16)
+	{
+		CHECK(oversized == 0); // Below that, one character may not fit next to the overlap
+	}
+}
+
+static void testSplitter()
+{
+	std::mt19937 random(9);
+	std::string text = makeText(random, 2000);
+
+	// Used to loop forever / cut characters
+	checkChunks(text, 2, 1);
+	checkChunks(text, 1, 5);
+	checkChunks(text, 0, 0);
+	checkChunks(text, 9, 4);
+	for (int round = 0; round < 3000; round++)
+	{
+		std::string randomText = makeText(random, random() % 3000);
+		size_t chunkSize = 1 + random() % 600;
+		checkChunks(randomText, chunkSize, random() % (chunkSize + 10));
+	}
+
+	// Line ends are preferred, the overlap starts at a line
+	std::string lines;
+	for (int i = 0; i < 100; i++)
+	{
+		lines += "line " + std::to_string(i) + " of the log\n";
+	}
+	std::vector<TextChunk> chunks = splitTextIntoChunks(lines, 256, 40);
+	CHECK(chunks.size() > 1);
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		CHECK(lines[chunks[i].end - 1] == '\n');
+		CHECK(chunks[i].begin == 0 || lines[chunks[i].begin - 1] == '\n');
+		CHECK(i == 0 || chunks[i].begin < chunks[i - 1].end);
+	}
+	CHECK(splitTextIntoChunks("", 256, 10).empty());
+}
+
+// Backend answering on its own threads after a random delay
+struct StubBackend
+{
+	std::mutex mutex;
+	std::vector<std::thread> threads;
+	std::atomic<int> running{ 0 };
+	std::atomic<int> maxRunning{ 0 };
+	std::atomic<unsigned long long> lastId{ 0 };
+	std::atomic<bool> isCancelled{ false };
+	std::string failingPrompt;
+
+	ChunkedJob::Backend backend()
+	{
+		return [this](const std::string& prompt, ChunkedJob::AnswerHandler onAnswer)
+		{
+			int runningNow = ++running;
+			int maxNow = maxRunning;
+			while (runningNow > maxNow && !maxRunning.compare_exchange_weak(maxNow, runningNow))
+			{
+			}
+			unsigned long long id = ++lastId;
+			std::lock_guard<std::mutex> lock(mutex);
+			threads.emplace_back([this, prompt, onAnswer, id]()
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1 + id * 7 % 13));
+				running--;
+				if (isCancelled)
+				{
+					onAnswer(false, "");
+				}
+				else
+				{
+					onAnswer(prompt != failingPrompt, prompt == failingPrompt ? "failed: " + prompt : "A(" + prompt + ")");
+				}
+			});
+			return id;
+		};
+	}
+
+	void join()
+	{
+		std::vector<std::thread> joined;
+		while (true)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (threads.empty())
+				{
+					return;
+				}
+				joined.swap(threads);
+			}
+			for (std::thread& thread : joined)
+			{
+				thread.join();
+			}
+			joined.clear();
+		}
+	}
+};
+
+static ChunkedJobResult runJob(StubBackend& stub, std::vector<std::string> prompts, size_t maxParallel, const std::string& reducePrompt, bool isCancelled = false)
+{
+	std::mutex mutex;
+	std::condition_variable finished;
+	bool isFinished = false;
+	ChunkedJobResult jobResult;
+	std::shared_ptr<ChunkedJob> job = std::make_shared<ChunkedJob>(prompts, maxParallel, reducePrompt, stub.backend(),
+		[&stub](ChunkedJob::BackendRequestId) { stub.isCancelled = true; },
+		[&](const ChunkedJobResult& result)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobResult = result;
+			isFinished = true;
+			finished.notify_all();
+		});
+	job->start();
+	if (isCancelled)
+	{
+		job->cancel();
+	}
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		CHECK(finished.wait_for(lock, std::chrono::seconds(30), [&isFinished]() { return isFinished; }));
+	}
+	stub.join();
+	return jobResult;
+}
+
+static void testJob()
+{
+	std::vector<std::string> prompts;
+	std::string expected;
+	for (int i = 0; i < 40; i++)
+	{
+		prompts.push_back(std::to_string(i));
+		expected += (i > 0 ? "\n\n" : "") + std::string("A(") + std::to_string(i) + ")";
+	}
+
+	// Map: max. 4 at once, stitched in order
+	StubBackend mapStub;
+	ChunkedJobResult result = runJob(mapStub, prompts, 4, "");
+	CHECK(result.isOK && !result.isCancelled);
+	CHECK(result.chunkCount == 40 && result.failedCount == 0);
+	CHECK(result.text == expected);
+	CHECK(mapStub.maxRunning <= 4 && mapStub.maxRunning >= 2);
+	CHECK(mapStub.lastId == 40);
+
+	// Reduce pass: one more request with the stitched answers
+	StubBackend reduceStub;
+	result = runJob(reduceStub, prompts, 3, "Sum up:");
+	CHECK(result.isOK);
+	CHECK(result.text == "A(Sum up:\n\n" + expected + ")");
+	CHECK(reduceStub.lastId == 41);
+
+	// A failed chunk: reported, no reduce pass
+	StubBackend failingStub;
+	failingStub.failingPrompt = "7";
+	result = runJob(failingStub, prompts, 4, "Sum up:");
+	CHECK(!result.isOK && result.failedCount == 1);
+	CHECK(result.errorText == "failed: 7");
+	CHECK(failingStub.lastId == 40);
+
+	// Cancel: the running chunks are cancelled, no more are sent
+	StubBackend cancelStub;
+	result = runJob(cancelStub, prompts, 4, "Sum up:", true);
+	CHECK(result.isCancelled && !result.isOK);
+	CHECK(cancelStub.lastId <= 4);
+}
+
+int main()
+{
+	testSplitter();
+	testJob();
+	return testResult();
+}
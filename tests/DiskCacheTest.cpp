@@ -0,0 +1,234 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// Disk cache recovery: a record torn at any byte (crash while appending), garbage or a corrupt record at the end are cut off,
+// the records before them survive and the file accepts new records
+#include "DiskCache.h"
+#include "TestCheck.h"
+#include <cstdio>
+#include <future>
+#include <random>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const int recordCount = 20;
+
+static std::string testKey(int i)
+{
+	return "{\"model\":\"test\",\"prompt\":\"question " + std::to_string(i) + "\"}";
+}
+
+static CachedResponse testResponse(int i)
+{
+	CachedResponse cachedResponse;
+	cachedResponse.response = "answer " + std::to_string(i) + std::string((size_t)(i * 37 % 101), 'x'); // Records of every padding
+	for (int value = 0; value < i % 5; value++)
+	{
+		cachedResponse.context.push_back(value * 1000 + i);
+	}
+	return cachedResponse;
+}
+
+// Synchronous lookup (the result comes from the cache thread)
+static bool lookup(DiskCache& cache, const std::string& key, CachedResponse& cachedResponse)
+{
+	std::shared_ptr<std::promise<std::pair<bool, CachedResponse>>> result = std::make_shared<std::promise<std::pair<bool, CachedResponse>>>();
+	std::future<std::pair<bool, CachedResponse>> future = result->get_future();
+	cache.get(key, [result](bool isFound, const CachedResponse& found) { result->set_value(std::make_pair(isFound, found)); });
+	std::pair<bool, CachedResponse> found = future.get();
+	cachedResponse = found.second;
+	return found.first;
+}
+
+static bool isStored(DiskCache& cache, int i)
+{
+	CachedResponse cachedResponse;
+	CachedResponse expected = testResponse(i);
+	return lookup(cache, testKey(i), cachedResponse) && cachedResponse.response == expected.response && cachedResponse.context == expected.context;
+}
+
+static uint64_t fileSize(const std::string& path)
+{
+	struct stat status;
+	return (::stat(path.c_str(), &status) == 0) ? (uint64_t)status.st_size : 0;
+}
+
+static std::string readFile(const std::string& path)
+{
+	std::string content;
+	FILE* file = std::fopen(path.c_str(), "rb");
+	if (file)
+	{
+		char buffer[4096];
+		size_t length;
+		while ((length = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+		{
+			content.append(buffer, length);
+		}
+		std::fclose(file);
+	}
+	return content;
+}
+
+static void writeFile(const std::string& path, const std::string& content)
+{
+	FILE* file = std::fopen(path.c_str(), "wb");
+	if (file)
+	{
+		std::fwrite(content.data(), 1, content.size(), file);
+		std::fclose(file);
+	}
+}
+
+// Write the records one by one, keeping the file size after each (the record boundaries)
+static std::vector<uint64_t> createCache(const std::string& path)
+{
+	std::remove(path.c_str());
+	std::vector<uint64_t> boundaries;
+	DiskCache cache;
+	cache.open(path, 64 * 1024 * 1024);
+	for (int i = 0; i < recordCount; i++)
+	{
+		CachedResponse cachedResponse;
+		lookup(cache, "sync", cachedResponse); // Wait for the previous record
+		boundaries.push_back(fileSize(path));
+		cache.put(testKey(i), testResponse(i));
+	}
+	cache.close();
+	boundaries.push_back(fileSize(path));
+	return boundaries;
+}
+
+// Reopen `content`: the first `survivorCount` records are found, the rest (`recoveredBytes`) is cut off
+static void checkRecovery(const std::string& path, const std::string& content, int survivorCount, uint64_t validSize)
+{
+	writeFile(path, content);
+	{
+		DiskCache cache;
+		cache.open(path, 64 * 1024 * 1024);
+		for (int i = 0; i < recordCount; i++)
+		{
+			CHECK(isStored(cache, i) == (i < survivorCount));
+		}
+		DiskCacheStats stats = cache.stats();
+		CHECK(stats.entries == (size_t)survivorCount);
+		CHECK(stats.recoveredBytes == content.size() - validSize);
+		CHECK(fileSize(path) == validSize);
+
+		cache.put(testKey(recordCount - 1), testResponse(recordCount - 1)); // Appended after the cut
+		cache.close();
+	}
+	DiskCache cache;
+	cache.open(path, 64 * 1024 * 1024);
+	CHECK(isStored(cache, recordCount - 1));
+	CHECK(cache.stats().recoveredBytes == 0);
+	cache.close();
+}
+
+static void testTornWrites(const std::string& path)
+{
+	std::vector<uint64_t> boundaries = createCache(path);
+	std::string content = readFile(path);
+	CHECK(content.size() == boundaries.back());
+
+	// Every cut inside the last record: the 19 records before it are kept
+	uint64_t lastStart = boundaries[recordCount - 1];
+	for (uint64_t cut = lastStart; cut < content.size(); cut++)
+	{
+		checkRecovery(path, content.substr(0, (size_t)cut), recordCount - 1, lastStart);
+	}
+
+	// Random cuts anywhere
+	std::mt19937 random(5);
+	for (int i = 0; i < 40; i++)
+	{
+		uint64_t cut = boundaries[0] + random() % (content.size() - boundaries[0]);
+		int survivorCount = 0;
+		while (boundaries[survivorCount + 1] <= cut)
+		{
+			survivorCount++;
+		}
+		checkRecovery(path, content.substr(0, (size_t)cut), survivorCount, boundaries[survivorCount]);
+	}
+}
+
+static void testCorruptRecords(const std::string& path)
+{
+	std::vector<uint64_t> boundaries = createCache(path);
+	std::string content = readFile(path);
+
+	// Garbage after the last record (e.g. a preallocated block): every record survives
+	std::string garbage = content;
+	std::mt19937 random(17);
+	for (int i = 0; i < 100; i++)
+	{
+		garbage += (char)(random() % 256);
+	}
+	checkRecovery(path, garbage, recordCount, content.size());
+
+	// A flipped byte in a record's payload: the checksum fails, that record and the ones after it are dropped
+	std::string corrupt = content;
+	corrupt[(size_t)boundaries[12] + 40] ^= 0x20;
+	checkRecovery(path, corrupt, 12, boundaries[12]);
+
+	// A zeroed header (a page never written)
+	std::string zeroed = content;
+	for (size_t i = 0; i < 32; i++)
+	{
+		zeroed[(size_t)boundaries[15] + i] = 0;
+	}
+	checkRecovery(path, zeroed, 15, boundaries[15]);
+}
+
+// Disabled (never opened, size 0, or the file can't be opened): no cache thread, no file, misses at once
+static void testDisabled(const std::string& path)
+{
+	std::remove(path.c_str());
+	DiskCache cache;
+	cache.put(testKey(0), testResponse(0));
+	CachedResponse cachedResponse;
+	CHECK(!lookup(cache, testKey(0), cachedResponse));
+	cache.open(path, 0);
+	cache.put(testKey(0), testResponse(0));
+	CHECK(!lookup(cache, testKey(0), cachedResponse));
+	cache.close();
+	CHECK(fileSize(path) == 0);
+	CHECK(cache.stats().writes == 0);
+
+	cache.open(path + "/not-a-directory/responses.cache", 64 * 1024 * 1024);
+	CHECK(!lookup(cache, testKey(0), cachedResponse)); // Runs after the failed open
+	CHECK(!cache.isEnabled());
+	cache.close();
+}
+
+int main()
+{
+	char directoryTemplate[] = "/tmp/DiskCacheTestXXXXXX";
+	const char* directory = ::mkdtemp(directoryTemplate);
+	CHECK(directory != nullptr);
+	if (directory)
+	{
+		std::string path = std::string(directory) + "/responses.cache";
+		testTornWrites(path);
+		testCorruptRecords(path);
+		testDisabled(path);
+		std::remove(path.c_str());
+		::rmdir(directory);
+	}
+	return testResult();
+}
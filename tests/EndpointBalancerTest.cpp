@@ -0,0 +1,264 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+// Requests are spread over the servers by capacity, failing servers are ejected, chats stay on their server
+#include "EndpointBalancer.h"
+#include "RequestEngine.h"
+#include "StubServer.h"
+#include "TestCheck.h"
+#include <queue>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+typedef std::chrono::steady_clock Clock;
+
+// The balancer with a simulated clock
+class SimulatedBalancer : public EndpointBalancer
+{
+public:
+	Clock::time_point time = Clock::time_point() + std::chrono::hours(1);
+
+protected:
+	Clock::time_point now() const override { return time; };
+};
+
+// A simulated server: every request takes `seconds` (`isDead`: refused after 2 ms), `slots` at once
+struct SimulatedServer
+{
+	double seconds;
+	bool isDead;
+};
+
+// Keep `inFlight` requests running until `requestCount` were sent; returns the requests per server
+static std::vector<size_t> simulate(const std::vector<SimulatedServer>& servers, size_t inFlight, size_t requestCount)
+{
+	SimulatedBalancer balancer;
+	std::vector<std::string> baseURLs;
+	for (size_t i = 0; i < servers.size(); i++)
+	{
+		baseURLs.push_back("http://box" + std::to_string(i) + ":11434");
+	}
+	balancer.setEndpoints(baseURLs);
+
+	struct Completion
+	{
+		Clock::time_point time;
+		int endpoint;
+		bool operator<(const Completion& other) const { return time > other.time; };
+	};
+	std::priority_queue<Completion> completions;
+	std::vector<size_t> requests(servers.size(), 0);
+	size_t sentCount = 0;
+	auto send = [&]()
+	{
+		std::string baseURL;
+		int endpoint = balancer.acquire(0, baseURL);
+		requests[endpoint]++;
+		sentCount++;
+		double seconds = servers[endpoint].isDead ? 0.002 : servers[endpoint].seconds;
+		completions.push({ balancer.time + std::chrono::microseconds((long long)(seconds * 1000000)), endpoint });
+	};
+	for (size_t i = 0; i < inFlight; i++)
+	{
+		send();
+	}
+	while (!completions.empty())
+	{
+		Completion completion = completions.top();
+		completions.pop();
+		balancer.time = completion.time;
+		const SimulatedServer& server = servers[completion.endpoint];
+		balancer.release(completion.endpoint, server.isDead ? 0.002 : server.seconds, !server.isDead, true);
+		if (sentCount < requestCount)
+		{
+			send();
+		}
+	}
+	return requests;
+}
+
+// A dead server fails in ms, while an answer takes seconds: it must not attract the requests
+static void testDeadServers()
+{
+	std::vector<size_t> requests = simulate({ { 6.0, false }, { 0, true }, { 0, true } }, 4, 300);
+	std::printf("6 s server + 2 dead ones: %zu / %zu / %zu requests\n", requests[0], requests[1], requests[2]);
+	CHECK(requests[0] >= 270);
+
+	// Back again: it's probed after its backoff, then gets its share
+	SimulatedBalancer balancer;
+	balancer.setEndpoints({ "http://a", "http://b" });
+	std::string baseURL;
+	int endpoint = balancer.acquire(0, baseURL);
+	balancer.release(endpoint, 0.002, false, true);
+	for (int i = 0; i < 20; i++)
+	{
+		int other = balancer.acquire(0, baseURL);
+		CHECK(other != endpoint);
+		balancer.release(other, 1.0, true, true);
+	}
+	balancer.time += std::chrono::milliseconds(1500);
+	int probe = -1;
+	for (int i = 0; i < 20 && probe != endpoint; i++)
+	{
+		probe = balancer.acquire(0, baseURL);
+		if (probe != endpoint)
+		{
+			balancer.release(probe, 1.0, true, true);
+		}
+	}
+	CHECK(probe == endpoint);
+	int second = balancer.acquire(0, baseURL);
+	CHECK(second != endpoint); // One probe at a time
+	balancer.release(second, 1.0, true, true);
+	balancer.release(probe, 0.5, true, true);
+	CHECK(balancer.stats()[endpoint].consecutiveFailures == 0);
+
+	// Every server down: the requests still go somewhere (and fail)
+	balancer.release(balancer.acquire(0, baseURL), 0.002, false, true);
+	balancer.release(balancer.acquire(0, baseURL), 0.002, false, true);
+	CHECK(balancer.acquire(0, baseURL) >= 0);
+}
+
+// Servers of 1x, 2x and 4x speed (one request at a time each): the requests follow the capacity
+static void testCapacity()
+{
+	std::vector<size_t> requests = simulate({ { 4.0, false }, { 2.0, false }, { 1.0, false } }, 6, 700);
+	std::printf("4 s / 2 s / 1 s servers: %zu / %zu / %zu requests\n", requests[0], requests[1], requests[2]);
+	CHECK(requests[0] < requests[1] && requests[1] < requests[2]);
+	CHECK(requests[2] > 700 / 3);
+}
+
+// A pinned session keeps its server until it fails
+static void testPinnedSessions()
+{
+	SimulatedBalancer balancer;
+	balancer.setEndpoints({ "http://a", "http://b", "http://c" });
+	std::string baseURL;
+	int endpoint = balancer.acquire(42, baseURL);
+	balancer.release(endpoint, 5.0, true, true);
+	for (int i = 0; i < 50; i++)
+	{
+		int other = balancer.acquire(0, baseURL);
+		balancer.release(other, 0.1, true, true);
+		CHECK(balancer.acquire(42, baseURL) == endpoint);
+		balancer.release(endpoint, 5.0, true, true);
+	}
+	endpoint = balancer.acquire(42, baseURL);
+	balancer.release(endpoint, 0.002, false, true);
+	int newEndpoint = balancer.acquire(42, baseURL);
+	CHECK(newEndpoint != endpoint);
+	balancer.release(newEndpoint, 1.0, true, true);
+
+	// Same list again: the pins + counters stay
+	balancer.setEndpoints({ "http://a", "http://b", "http://c" });
+	CHECK(balancer.acquire(42, baseURL) == newEndpoint);
+	balancer.release(newEndpoint, 1.0, true, true);
+	unsigned long long requests = 0;
+	for (const EndpointStats& stats : balancer.stats())
+	{
+		requests += stats.requests;
+	}
+	CHECK(requests == 1 + 100 + 3);
+}
+
+// A local port nobody listens on
+static std::string refusedURL()
+{
+	int listenSocket = ::socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addressLength = sizeof(address);
+	::bind(listenSocket, (sockaddr*)&address, sizeof(address));
+	::getsockname(listenSocket, (sockaddr*)&address, &addressLength);
+	::close(listenSocket);
+	return "http://127.0.0.1:" + std::to_string(ntohs(address.sin_port));
+}
+
+// Real transfers: three stub servers of different speeds (one request at a time each) + a dead one
+static void testStubServers()
+{
+	auto makeServer = [](int milliseconds)
+	{
+		return std::unique_ptr<StubServer>(new StubServer([milliseconds](const std::string&, const std::string&)
+		{
+			StubReply reply;
+			reply.parts.push_back("{\"response\":\"ok\",\"done\":true}");
+			reply.delay = std::chrono::milliseconds(milliseconds);
+			return reply;
+		}, 1));
+	};
+	std::unique_ptr<StubServer> slowServer = makeServer(800);
+	std::unique_ptr<StubServer> mediumServer = makeServer(400);
+	std::unique_ptr<StubServer> fastServer = makeServer(200);
+
+	CurlTransport transport;
+	CHECK(transport.init());
+	EndpointBalancer endpoints;
+	endpoints.setEndpoints({ slowServer->URL(), mediumServer->URL(), fastServer->URL(), refusedURL() });
+	RequestEngine engine(transport, endpoints);
+	CHECK(engine.start(6));
+
+	const size_t requestCount = 80;
+	std::mutex mutex;
+	std::condition_variable finished;
+	size_t finishedCount = 0;
+	size_t failedCount = 0;
+	for (size_t i = 0; i < requestCount; i++)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			finished.wait(lock, [&]() { return i - finishedCount < 6; }); // Keep 6 running
+		}
+		OllamaRequest request;
+		request.URL = "/api/generate";
+		request.proxyURL = "0";
+		request.postFields = "{\"prompt\":\"" + std::to_string(i) + "\"}";
+		request.onData = [](const char*, size_t) {};
+		request.onComplete = [&](const RequestResult& result)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			failedCount += (result.isOK() && result.httpStatus == 200) ? 0 : 1;
+			finishedCount++;
+			finished.notify_all();
+		};
+		CHECK(engine.submit(request) != 0);
+	}
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		CHECK(finished.wait_for(lock, std::chrono::seconds(120), [&]() { return finishedCount == requestCount; }));
+	}
+	engine.stop();
+
+	std::vector<EndpointStats> stats = endpoints.stats();
+	std::printf("800 / 400 / 200 ms servers + a dead one: %llu / %llu / %llu / %llu requests (%zu failed)\n",
+		stats[0].requests, stats[1].requests, stats[2].requests, stats[3].requests, failedCount);
+	CHECK(stats[3].failures == stats[3].requests && failedCount == stats[3].requests);
+	CHECK(stats[3].requests <= 6);
+	CHECK(stats[0].requests < stats[2].requests && stats[1].requests < stats[2].requests);
+	CHECK(stats[2].requests >= requestCount / 3);
+}
+
+int main()
+{
+	testDeadServers();
+	testCapacity();
+	testPinnedSessions();
+	testStubServers();
+	return testResult();
+}
@@ -0,0 +1,125 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// inotify watcher: debounced changes of the watched files only, saves via rename, signals don't stop the thread
+#include "FileWatcher.h"
+#include "TestCheck.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+#include <pthread.h>
+#include <unistd.h>
+
+typedef std::chrono::steady_clock Clock;
+
+static void writeFile(const std::string& path, const std::string& text)
+{
+	FILE* file = std::fopen(path.c_str(), "wb");
+	if (file)
+	{
+		std::fwrite(text.data(), 1, text.size(), file);
+		std::fclose(file);
+	}
+}
+
+// Wait until `count` reaches `expected` (max. `timeout`)
+static bool waitFor(const std::atomic<int>& count, int expected, std::chrono::milliseconds timeout)
+{
+	Clock::time_point deadline = Clock::now() + timeout;
+	while (count < expected && Clock::now() < deadline)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return count >= expected;
+}
+
+static void onSignal(int)
+{
+}
+
+static void testFileWatcher()
+{
+	char directoryTemplate[] = "/tmp/FileWatcherTestXXXXXX";
+	const char* directoryName = ::mkdtemp(directoryTemplate);
+	CHECK(directoryName != nullptr);
+	if (!directoryName)
+	{
+		return;
+	}
+	std::string directory = directoryName;
+	std::atomic<int> changeCount{ 0 };
+	FileWatcher watcher;
+	CHECK(watcher.start(directory, { "NppOpenAI.ini", "NppOpenAI_instructions" }, std::chrono::milliseconds(200), [&changeCount]() { changeCount++; }));
+
+	// Several writes in a row: one `onChange`, after the quiet period
+	Clock::time_point startTime = Clock::now();
+	for (int i = 0; i < 5; i++)
+	{
+		writeFile(directory + "/NppOpenAI.ini", "[API]\nmodel=" + std::to_string(i) + "\n");
+		std::this_thread::sleep_for(std::chrono::milliseconds(30));
+	}
+	CHECK(waitFor(changeCount, 1, std::chrono::seconds(5)));
+	CHECK(Clock::now() - startTime >= std::chrono::milliseconds(200));
+	std::this_thread::sleep_for(std::chrono::milliseconds(400));
+	CHECK(changeCount == 1);
+	CHECK(watcher.stats().events >= 5);
+
+	// Other files are ignored
+	writeFile(directory + "/other.txt", "x");
+	std::this_thread::sleep_for(std::chrono::milliseconds(400));
+	CHECK(changeCount == 1);
+
+	// Save via a temporary file + rename (IN_MOVED_TO)
+	writeFile(directory + "/instructions.tmp", "Be brief");
+	CHECK(std::rename((directory + "/instructions.tmp").c_str(), (directory + "/NppOpenAI_instructions").c_str()) == 0);
+	CHECK(waitFor(changeCount, 2, std::chrono::seconds(5)));
+
+	// Signals interrupt `poll()` on the watcher thread (the only one not blocking SIGUSR1): it keeps watching
+	struct sigaction action = {};
+	action.sa_handler = onSignal; // No SA_RESTART
+	::sigaction(SIGUSR1, &action, nullptr);
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGUSR1);
+	::pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+	for (int i = 0; i < 5; i++)
+	{
+		::kill(::getpid(), SIGUSR1);
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+	writeFile(directory + "/NppOpenAI.ini", "[API]\nmodel=after signals\n");
+	CHECK(waitFor(changeCount, 3, std::chrono::seconds(5)));
+
+	watcher.stop();
+	CHECK(!watcher.isRunning());
+	FileWatcherStats stats = watcher.stats();
+	CHECK(stats.changes == 3);
+	std::printf("%llu events -> %llu changes\n", stats.events, stats.changes);
+
+	std::remove((directory + "/NppOpenAI.ini").c_str());
+	std::remove((directory + "/NppOpenAI_instructions").c_str());
+	std::remove((directory + "/other.txt").c_str());
+	::rmdir(directory.c_str());
+}
+
+int main()
+{
+	testFileWatcher();
+	return testResult();
+}
@@ -0,0 +1,198 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// Benchmark: the SAX reader of `parseOllamaChunk()` against a DOM (`json::parse()` + field lookups, as before) on 1 MB responses.
+// Both must extract the same fields; the MB/s of each are printed.
+#include "OllamaStream.h"
+#include "TestCheck.h"
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <random>
+
+using json = nlohmann::json;
+typedef std::chrono::steady_clock Clock;
+
+// The DOM parser replaced by the SAX reader
+static bool parseOllamaChunkDOM(const char* line, size_t length, OllamaChunk& chunk)
+{
+	json JSONChunk = json::parse(line, line + length, nullptr, false); // No exceptions
+	if (JSONChunk.is_discarded() || !JSONChunk.is_object())
+	{
+		return false;
+	}
+	if (JSONChunk.contains("response") && JSONChunk["response"].is_string())
+	{
+		JSONChunk["response"].get_to(chunk.response);
+		chunk.hasResponse = true;
+	}
+	else if (JSONChunk.contains("message") && JSONChunk["message"].is_object()
+		&& JSONChunk["message"].contains("content") && JSONChunk["message"]["content"].is_string())
+	{
+		JSONChunk["message"]["content"].get_to(chunk.response);
+		chunk.hasResponse = true;
+	}
+	if (JSONChunk.contains("error") && JSONChunk["error"].is_string())
+	{
+		JSONChunk["error"].get_to(chunk.error);
+	}
+	if (JSONChunk.contains("done") && JSONChunk["done"].is_boolean())
+	{
+		JSONChunk["done"].get_to(chunk.done);
+	}
+	if (chunk.done)
+	{
+		if (JSONChunk.contains("context") && JSONChunk["context"].is_array())
+		{
+			JSONChunk["context"].get_to(chunk.context);
+		}
+		if (JSONChunk.contains("prompt_eval_count") && JSONChunk["prompt_eval_count"].is_number_integer())
+		{
+			JSONChunk["prompt_eval_count"].get_to(chunk.promptEvalCount);
+		}
+		if (JSONChunk.contains("prompt_eval_duration") && JSONChunk["prompt_eval_duration"].is_number_integer())
+		{
+			JSONChunk["prompt_eval_duration"].get_to(chunk.promptEvalDuration);
+		}
+		if (JSONChunk.contains("eval_count") && JSONChunk["eval_count"].is_number_integer())
+		{
+			JSONChunk["eval_count"].get_to(chunk.evalCount);
+		}
+	}
+	return true;
+}
+
+// Non-streamed `/api/generate` answer of ~1 MB: escaped text (code, quotes, newlines, non-ASCII) + a long `context`
+static std::string bigResponse(bool isChat)
+{
+	static const char* const words[] = { "the", "answer", "is", "\\\"quoted\\\"", "line\\n", "\\tindented", "caf\xC3\xA9", "\\u00e9t\\u00e9", "{x: 1}", "\xE2\x82\xAC" };
+	std::mt19937 random(7);
+	std::string answer;
+	while (answer.size() < (isChat ? 1000 : 700) * 1024) // + `context`: ~1 MB
+	{
+		answer += words[random() % (sizeof(words) / sizeof(words[0]))];
+		answer += ' ';
+	}
+	std::string line = "{\"model\":\"llama3.2\",\"created_at\":\"2024-01-01T00:00:00Z\",";
+	line += isChat ? "\"message\":{\"role\":\"assistant\",\"content\":\"" + answer + "\"}," : "\"response\":\"" + answer + "\",";
+	line += "\"done\":true,\"done_reason\":\"stop\"";
+	if (!isChat)
+	{
+		line += ",\"context\":[";
+		for (int i = 0; i < 40000; i++)
+		{
+			line += (i > 0 ? "," : "") + std::to_string(random() % 128000);
+		}
+		line += ']';
+	}
+	line += ",\"total_duration\":123456789,\"prompt_eval_count\":26,\"prompt_eval_duration\":130079000,\"eval_count\":259,\"eval_duration\":4232710000}";
+	return line;
+}
+
+static bool isSameChunk(const OllamaChunk& chunk, const OllamaChunk& other)
+{
+	return chunk.response == other.response && chunk.error == other.error && chunk.hasResponse == other.hasResponse && chunk.done == other.done
+		&& chunk.context == other.context && chunk.promptEvalCount == other.promptEvalCount
+		&& chunk.promptEvalDuration == other.promptEvalDuration && chunk.evalCount == other.evalCount;
+}
+
+static void benchmark(const char* name, const std::string& line)
+{
+	const int rounds = 20;
+	OllamaChunk saxChunk, domChunk;
+	CHECK(parseOllamaChunk(line.data(), line.size(), saxChunk));
+	CHECK(parseOllamaChunkDOM(line.data(), line.size(), domChunk));
+	CHECK(isSameChunk(saxChunk, domChunk));
+	CHECK(saxChunk.done && saxChunk.response.size() > 500 * 1024);
+
+	size_t checksum = 0;
+	Clock::time_point startTime = Clock::now();
+	for (int round = 0; round < rounds; round++)
+	{
+		OllamaChunk chunk;
+		parseOllamaChunk(line.data(), line.size(), chunk);
+		checksum += chunk.response.size() + chunk.context.size();
+	}
+	double saxSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+
+	startTime = Clock::now();
+	for (int round = 0; round < rounds; round++)
+	{
+		OllamaChunk chunk;
+		parseOllamaChunkDOM(line.data(), line.size(), chunk);
+		checksum -= chunk.response.size() + chunk.context.size();
+	}
+	double domSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+	CHECK(checksum == 0);
+
+	double megabytes = (double)line.size() * rounds / 1e6;
+	std::printf("%s (%.2f MB): SAX %.0f MB/s, DOM %.0f MB/s (x%.1f)\n", name, (double)line.size() / 1e6,
+		megabytes / saxSeconds, megabytes / domSeconds, domSeconds / saxSeconds);
+}
+
+// Streamed: ~1 MB of small NDJSON lines through `OllamaStream`, against a DOM per line
+static void benchmarkStream()
+{
+	std::string stream;
+	int lineCount = 0;
+	while (stream.size() < 1024 * 1024)
+	{
+		stream += "{\"model\":\"llama3.2\",\"created_at\":\"2024-01-01T00:00:00.000000Z\",\"response\":\" token" + std::to_string(lineCount++) + "\",\"done\":false}\n";
+	}
+	stream += "{\"model\":\"llama3.2\",\"response\":\"\",\"done\":true,\"eval_count\":" + std::to_string(lineCount) + "}\n";
+
+	const int rounds = 10;
+	std::string saxText, domText;
+	Clock::time_point startTime = Clock::now();
+	for (int round = 0; round < rounds; round++)
+	{
+		saxText.clear();
+		OllamaStream ollamaStream([&saxText](const OllamaChunk& chunk) { saxText += chunk.response; });
+		ollamaStream.feed(stream.data(), stream.size());
+		ollamaStream.finish();
+		CHECK(ollamaStream.isDone());
+	}
+	double saxSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+
+	startTime = Clock::now();
+	for (int round = 0; round < rounds; round++)
+	{
+		domText.clear();
+		size_t start = 0, end;
+		while ((end = stream.find('\n', start)) != std::string::npos)
+		{
+			OllamaChunk chunk;
+			parseOllamaChunkDOM(stream.data() + start, end - start, chunk);
+			domText += chunk.response;
+			start = end + 1;
+		}
+	}
+	double domSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+	CHECK(saxText == domText);
+
+	double megabytes = (double)stream.size() * rounds / 1e6;
+	std::printf("stream of %d lines (%.2f MB): SAX %.0f MB/s, DOM %.0f MB/s (x%.1f)\n", lineCount, (double)stream.size() / 1e6,
+		megabytes / saxSeconds, megabytes / domSeconds, domSeconds / saxSeconds);
+}
+
+int main()
+{
+	benchmark("/api/generate", bigResponse(false));
+	benchmark("/api/chat", bigResponse(true));
+	benchmarkStream();
+	return testResult();
+}
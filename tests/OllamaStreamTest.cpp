@@ -0,0 +1,183 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+// Streaming of /api/generate: NDJSON lines split anywhere by cURL are parsed into the same fragments,
+// and the first fragment arrives while a stub server is still dripping the answer
+#include "OllamaStream.h"
+#include "RequestEngine.h"
+#include "StubServer.h"
+#include "TestCheck.h"
+#include <random>
+
+static std::vector<std::string> makeNDJSONLines(size_t count)
+{
+	std::vector<std::string> lines;
+	for (size_t i = 0; i < count; i++)
+	{
+		lines.push_back("{\"model\":\"stub\",\"response\":\"t\\u00e9" + std::to_string(i) + " \",\"done\":false}\n");
+	}
+	lines.push_back("{\"model\":\"stub\",\"response\":\"\",\"done\":true,\"context\":[1,2,3],\"prompt_eval_count\":7,\"eval_count\":" + std::to_string(count) + "}\n");
+	return lines;
+}
+
+static std::string expectedAnswer(size_t count)
+{
+	std::string answer;
+	for (size_t i = 0; i < count; i++)
+	{
+		answer += "t\xC3\xA9" + std::to_string(i) + " ";
+	}
+	return answer;
+}
+
+// Every split of the byte stream gives the same chunks
+static void testRandomSplits()
+{
+	std::string stream;
+	for (const std::string& line : makeNDJSONLines(50))
+	{
+		stream += line;
+	}
+	stream.pop_back(); // The last line may come without '\n'
+
+	std::mt19937 random(1);
+	for (int round = 0; round < 2000; round++)
+	{
+		std::string answer;
+		OllamaChunk lastChunk;
+		size_t chunkCount = 0;
+		OllamaStream parser([&](const OllamaChunk& chunk)
+		{
+			answer += chunk.response;
+			lastChunk = chunk;
+			chunkCount++;
+		});
+		size_t pos = 0;
+		while (pos < stream.size())
+		{
+			size_t length = 1 + random() % 40;
+			length = (length < stream.size() - pos) ? length : stream.size() - pos;
+			parser.feed(stream.data() + pos, length);
+			pos += length;
+		}
+		parser.finish();
+		CHECK(chunkCount == 51);
+		CHECK(answer == expectedAnswer(50));
+		CHECK(parser.isDone() && lastChunk.done);
+		CHECK(lastChunk.context == std::vector<int>({ 1, 2, 3 }));
+		CHECK(lastChunk.promptEvalCount == 7 && lastChunk.evalCount == 50);
+		CHECK(parser.invalidText().empty());
+	}
+}
+
+// A proxy error page is not JSON: kept for the error message
+static void testInvalidLines()
+{
+	std::string answer;
+	OllamaStream parser([&](const OllamaChunk& chunk) { answer += chunk.response; });
+	std::string text = "404 page not found";
+	parser.feed(text.data(), text.size());
+	parser.finish();
+	CHECK(!parser.isDone());
+	CHECK(answer.empty());
+	CHECK(parser.invalidText().find("404 page not found") != std::string::npos);
+
+	OllamaChunk chunk;
+	std::string error = "{\"error\":\"model 'x' not found\"}";
+	CHECK(parseOllamaChunk(error.data(), error.size(), chunk));
+	CHECK(chunk.error == "model 'x' not found");
+}
+
+// Real transfer: the fragments are passed on while the server is still generating
+static void testDrippedStream()
+{
+	const size_t lineCount = 20;
+	StubServer server([lineCount](const std::string& path, const std::string&)
+	{
+		StubReply reply;
+		reply.status = (path == "/api/generate") ? 200 : 404;
+		reply.parts = makeNDJSONLines(lineCount);
+		reply.partDelay = std::chrono::milliseconds(30);
+		return reply;
+	});
+	CHECK(server.isRunning());
+
+	CurlTransport transport;
+	CHECK(transport.init());
+	EndpointBalancer endpoints;
+	endpoints.setEndpoints({ server.URL() });
+	RequestEngine engine(transport, endpoints);
+	CHECK(engine.start(4));
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point startTime = Clock::now();
+	Clock::time_point firstFragmentTime;
+	std::string answer;
+	bool isDone = false;
+	std::mutex mutex;
+	std::condition_variable finished;
+	bool isFinished = false;
+	RequestResult lastResult;
+	OllamaStream parser([&](const OllamaChunk& chunk)
+	{
+		if (answer.empty() && !chunk.response.empty())
+		{
+			firstFragmentTime = Clock::now();
+		}
+		answer += chunk.response;
+		isDone = isDone || chunk.done;
+	});
+
+	OllamaRequest request;
+	request.URL = "/api/generate";
+	request.proxyURL = "0";
+	request.postFields = "{\"model\":\"stub\",\"prompt\":\"Hi\",\"stream\":true}";
+	request.onData = [&parser](const char* data, size_t length) { parser.feed(data, length); };
+	request.onComplete = [&](const RequestResult& result)
+	{
+		parser.finish();
+		std::lock_guard<std::mutex> lock(mutex);
+		lastResult = result;
+		isFinished = true;
+		finished.notify_all();
+	};
+	CHECK(engine.submit(request) != 0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	CHECK(finished.wait_for(lock, std::chrono::seconds(30), [&isFinished]() { return isFinished; }));
+	Clock::time_point endTime = Clock::now();
+	CHECK(lastResult.isOK() && lastResult.httpStatus == 200);
+	CHECK(isDone);
+	CHECK(answer == expectedAnswer(lineCount));
+
+	// ~600 ms of drip: the first fragment comes with the first line, not at the end
+	long long firstMilliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(firstFragmentTime - startTime).count();
+	long long totalMilliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
+	std::printf("first fragment after %lld ms, whole answer after %lld ms\n", firstMilliseconds, totalMilliseconds);
+	CHECK(totalMilliseconds >= 500);
+	CHECK(firstMilliseconds * 3 < totalMilliseconds);
+	lock.unlock();
+	engine.stop();
+}
+
+int main()
+{
+	testRandomSplits();
+	testInvalidLines();
+	testDrippedStream();
+	return testResult();
+}
@@ -0,0 +1,258 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+// The engine thread drives many transfers at once (no thread per request), bounded by `maxInFlight`
+#include "RequestEngine.h"
+#include "StubServer.h"
+#include "TestCheck.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// Collects the results of the submitted requests
+struct ResultCollector
+{
+	std::mutex mutex;
+	std::condition_variable finished;
+	std::vector<RequestResult> results;
+	std::vector<std::string> bodies;
+
+	bool waitFor(size_t count, std::chrono::seconds timeout)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		return finished.wait_for(lock, timeout, [this, count]() { return results.size() >= count; });
+	}
+};
+
+static RequestId submitRequest(RequestEngine& engine, const std::string& URL, const std::string& body, ResultCollector& collector)
+{
+	std::shared_ptr<std::string> received = std::make_shared<std::string>();
+	OllamaRequest request;
+	request.URL = URL;
+	request.proxyURL = "0";
+	request.postFields = body;
+	request.onData = [received](const char* data, size_t length) { received->append(data, length); };
+	request.onComplete = [received, &collector](const RequestResult& result)
+	{
+		std::lock_guard<std::mutex> lock(collector.mutex);
+		collector.results.push_back(result);
+		collector.bodies.push_back(*received);
+		collector.finished.notify_all();
+	};
+	return engine.submit(request);
+}
+
+// 100 requests of 300 ms each at once: they overlap on the one engine thread
+static void testConcurrentRequests()
+{
+	StubServer server([](const std::string&, const std::string& body)
+	{
+		StubReply reply;
+		reply.parts.push_back("{\"response\":\"" + body + "\",\"done\":true}");
+		reply.delay = std::chrono::milliseconds(300);
+		return reply;
+	});
+	CurlTransport transport;
+	CHECK(transport.init());
+	EndpointBalancer endpoints;
+	RequestEngine engine(transport, endpoints);
+	CHECK(engine.start(100));
+
+	ResultCollector collector;
+	Clock::time_point startTime = Clock::now();
+	for (int i = 0; i < 100; i++)
+	{
+		CHECK(submitRequest(engine, server.URL() + "/api/generate", std::to_string(i), collector) != 0);
+	}
+	CHECK(collector.waitFor(100, std::chrono::seconds(60)));
+	long long milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - startTime).count();
+	std::printf("100 concurrent requests: %lld ms, max. %zu at once on the server\n", milliseconds, server.maxConcurrent());
+
+	std::lock_guard<std::mutex> lock(collector.mutex);
+	size_t okCount = 0;
+	for (size_t i = 0; i < collector.results.size(); i++)
+	{
+		okCount += (collector.results[i].isOK() && collector.results[i].httpStatus == 200
+			&& collector.bodies[i].find("\"done\":true") != std::string::npos) ? 1 : 0;
+	}
+	CHECK(okCount == 100);
+	CHECK(server.requestCount() == 100);
+	CHECK(server.maxConcurrent() >= 50);
+	CHECK(milliseconds < 100 * 300 / 4); // Far from one after the other
+	RequestEngineStats stats = engine.stats();
+	CHECK(stats.completed == 100 && stats.failed == 0);
+	CHECK(stats.maxInFlightSeen == 100);
+	engine.stop();
+}
+
+// `maxInFlight` bounds the transfers, the others wait in the queue
+static void testBoundedRequests()
+{
+	StubServer server([](const std::string&, const std::string&)
+	{
+		StubReply reply;
+		reply.parts.push_back("{\"done\":true}");
+		reply.delay = std::chrono::milliseconds(50);
+		return reply;
+	});
+	CurlTransport transport;
+	CHECK(transport.init());
+	EndpointBalancer endpoints;
+	RequestEngine engine(transport, endpoints);
+	CHECK(engine.start(8));
+
+	ResultCollector collector;
+	for (int i = 0; i < 100; i++)
+	{
+		CHECK(submitRequest(engine, server.URL() + "/api/generate", "{\"n\":" + std::to_string(i) + "}", collector) != 0);
+	}
+	CHECK(collector.waitFor(100, std::chrono::seconds(60)));
+	CHECK(server.maxConcurrent() <= 8);
+	RequestEngineStats stats = engine.stats();
+	CHECK(stats.completed == 100);
+	CHECK(stats.maxInFlightSeen == 8);
+
+	// Keep-alive: the connections are reused
+	CurlTransportStats transportStats = transport.stats();
+	CHECK(transportStats.connectionsOpened <= 8);
+	engine.stop();
+}
+
+// A cancelled request stops at once, even while the server is still generating
+static void testCancel()
+{
+	StubServer server([](const std::string&, const std::string&)
+	{
+		StubReply reply;
+		reply.parts.push_back("{\"done\":true}");
+		reply.delay = std::chrono::milliseconds(3000);
+		return reply;
+	});
+	CurlTransport transport;
+	CHECK(transport.init());
+	EndpointBalancer endpoints;
+	RequestEngine engine(transport, endpoints);
+	CHECK(engine.start(4));
+
+	ResultCollector collector;
+	RequestId requestId = submitRequest(engine, server.URL() + "/api/generate", "{}", collector);
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	Clock::time_point cancelTime = Clock::now();
+	CHECK(engine.cancel(requestId));
+	CHECK(collector.waitFor(1, std::chrono::seconds(10)));
+	CHECK(Clock::now() - cancelTime < std::chrono::milliseconds(1500));
+	std::lock_guard<std::mutex> lock(collector.mutex);
+	CHECK(collector.results[0].isCancelled);
+	CHECK(!engine.cancel(requestId));
+	engine.stop();
+}
+
+// An identical request joins the running one (the response so far is replayed to it) while that is under 256 KB;
+// past it the response isn't kept any more, so a new one is sent
+static void testLateFollowers()
+{
+	const std::string firstPart(100 * 1024, 'a'), secondPart(300 * 1024, 'b'), lastPart = "{\"done\":true}";
+	StubServer server([&](const std::string&, const std::string&)
+	{
+		StubReply reply;
+		reply.parts = { firstPart, secondPart, lastPart };
+		reply.partDelay = std::chrono::milliseconds(400);
+		return reply;
+	});
+	CurlTransport transport;
+	CHECK(transport.init());
+	EndpointBalancer endpoints;
+	RequestEngine engine(transport, endpoints);
+	CHECK(engine.start(4));
+
+	ResultCollector collector;
+	std::string URL = server.URL() + "/api/generate";
+	CHECK(submitRequest(engine, URL, "same", collector) != 0);
+	std::this_thread::sleep_for(std::chrono::milliseconds(200)); // First part received
+	CHECK(submitRequest(engine, URL, "same", collector) != 0);
+	CHECK(engine.stats().coalesced == 1);
+	std::this_thread::sleep_for(std::chrono::milliseconds(400)); // Second part received: over the bound
+	CHECK(submitRequest(engine, URL, "same", collector) != 0);
+	CHECK(engine.stats().coalesced == 1);
+
+	CHECK(collector.waitFor(3, std::chrono::seconds(30)));
+	std::lock_guard<std::mutex> lock(collector.mutex);
+	for (size_t i = 0; i < collector.results.size(); i++)
+	{
+		CHECK(collector.results[i].isOK());
+		CHECK(collector.bodies[i] == firstPart + secondPart + lastPart);
+	}
+	CHECK(server.requestCount() == 2);
+	engine.stop();
+}
+
+// A callback that never returns: `stop()` gives up after its deadline + leaves the multi handle to the thread.
+// Everything the thread uses is leaked on purpose, as in the plugin at shutdown.
+static void testStopWithBlockedCallback()
+{
+	StubServer* server = new StubServer([](const std::string&, const std::string&)
+	{
+		StubReply reply;
+		reply.parts.push_back("{\"response\":\"a\",\"done\":false}\n");
+		reply.parts.push_back("{\"response\":\"b\",\"done\":true}\n");
+		reply.partDelay = std::chrono::milliseconds(100);
+		return reply;
+	});
+	CurlTransport* transport = new CurlTransport();
+	CHECK(transport->init());
+	EndpointBalancer* endpoints = new EndpointBalancer();
+	RequestEngine* engine = new RequestEngine(*transport, *endpoints);
+	CHECK(engine->start(4));
+
+	std::shared_ptr<std::atomic<bool>> isInCallback = std::make_shared<std::atomic<bool>>(false);
+	std::shared_ptr<std::atomic<int>> completeCount = std::make_shared<std::atomic<int>>(0);
+	OllamaRequest request;
+	request.URL = server->URL() + "/api/generate";
+	request.proxyURL = "0";
+	request.postFields = "{}";
+	request.onData = [isInCallback](const char*, size_t)
+	{
+		*isInCallback = true;
+		std::this_thread::sleep_for(std::chrono::hours(1));
+	};
+	request.onComplete = [completeCount](const RequestResult&) { (*completeCount)++; };
+	CHECK(engine->submit(request) != 0);
+	for (int i = 0; i < 500 && !*isInCallback; i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	CHECK(*isInCallback);
+
+	Clock::time_point startTime = Clock::now();
+	CHECK(!engine->stop(std::chrono::milliseconds(300)));
+	CHECK(Clock::now() - startTime < std::chrono::seconds(5));
+	CHECK(!engine->isRunning());
+	CHECK(!engine->stop()); // Still left behind
+	CHECK(!engine->start(4)); // Would share the members with the old thread
+	CHECK(*completeCount == 0);
+	transport->abandon();
+	CHECK(!transport->isInitialized());
+}
+
+int main()
+{
+	testConcurrentRequests();
+	testBoundedRequests();
+	testCancel();
+	testLateFollowers();
+	testStopWithBlockedCallback();
+	return testResult();
+}
@@ -0,0 +1,93 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// Request bodies: valid JSON for any question (escapes, broken UTF-8), sampling settings in `options`
+#include "RequestTemplate.h"
+#include "TestCheck.h"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+static RequestTemplate compileTemplate()
+{
+	RequestTemplate::Settings settings;
+	settings.model = "llama3.2";
+	settings.temperature = 0.5;
+	settings.maxTokens = 100;
+	settings.contextLength = 2048;
+	settings.instructions = "Be \"brief\"\n";
+	RequestTemplate requestTemplate;
+	requestTemplate.compile(settings);
+	return requestTemplate;
+}
+
+// Parsed strictly (an invalid body would be rejected by Ollama)
+static bool parseBody(const std::string& body, json& parsed)
+{
+	try
+	{
+		parsed = json::parse(body);
+		return true;
+	}
+	catch (json::exception&)
+	{
+		return false;
+	}
+}
+
+static void testEscapes()
+{
+	RequestTemplate requestTemplate = compileTemplate();
+	std::string question = "tab\t \"quote\" back\\slash \x01\x1F caf\xC3\xA9 \xF0\x9F\x98\x80\r\n";
+	std::vector<int> context = { 1, 2, 3 };
+	json parsed;
+	CHECK(parseBody(requestTemplate.generateBody(question, &context, true), parsed));
+	CHECK(parsed["prompt"] == question);
+	CHECK(parsed["system"] == "Be \"brief\"\n");
+	CHECK(parsed["context"] == json({ 1, 2, 3 }));
+	CHECK(parsed["stream"] == true);
+	CHECK(parsed["options"]["temperature"] == 0.5);
+	CHECK(parsed["options"]["num_predict"] == 100);
+	CHECK(parsed["options"]["num_ctx"] == 2048);
+	CHECK(!parsed.contains("temperature") && !parsed.contains("max_tokens"));
+}
+
+// Broken bytes of a document: U+FFFD, like the `/api/chat` + `/api/embed` bodies (`error_handler_t::replace`)
+static void testInvalidUtf8()
+{
+	RequestTemplate requestTemplate = compileTemplate();
+	const char* const questions[] = { "a\xFF" "b", "cut \xE2\x82", "\xC0\xAF overlong", "\xED\xA0\x80 surrogate", "\x80\x80\x80" };
+	for (const char* question : questions)
+	{
+		json parsed;
+		CHECK(parseBody(requestTemplate.generateBody(question, nullptr, false), parsed));
+		std::string expected = json(question).dump(-1, ' ', false, json::error_handler_t::replace);
+		CHECK(parsed["prompt"].dump() == expected);
+	}
+
+	std::string out;
+	appendJSONString(out, "x\xFFy");
+	CHECK(out == "\"x\xEF\xBF\xBDy\"");
+}
+
+int main()
+{
+	testEscapes();
+	testInvalidUtf8();
+	return testResult();
+}
@@ -0,0 +1,138 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// Semantic cache: SIMD dot product against a scalar loop, threshold + scope of `find()`, ring replacement, reset on a new dimension
+#include "SemanticCache.h"
+#include "TestCheck.h"
+#include <cmath>
+#include <random>
+
+static std::vector<float> unitVector(size_t dimension, size_t axis)
+{
+	std::vector<float> vector(dimension, 0.0f);
+	vector[axis] = 1.0f;
+	return vector;
+}
+
+static CachedResponse answer(const std::string& text)
+{
+	CachedResponse cachedResponse;
+	cachedResponse.response = text;
+	return cachedResponse;
+}
+
+// Every length around the 8-float SIMD step (tail only, one step + tail...), unaligned starts too
+static void testDotProduct()
+{
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> values(-2.0f, 2.0f);
+	for (size_t length = 0; length <= 17; length++)
+	{
+		for (size_t offset = 0; offset < 3; offset++)
+		{
+			std::vector<float> a(length + 3), b(length + 3);
+			for (size_t i = 0; i < a.size(); i++)
+			{
+				a[i] = values(random);
+				b[i] = values(random);
+			}
+			double expected = 0.0;
+			double magnitude = 0.0;
+			for (size_t i = 0; i < length; i++)
+			{
+				expected += (double)a[offset + i] * b[offset + i];
+				magnitude += std::fabs((double)a[offset + i] * b[offset + i]);
+			}
+			float sum = dotProduct(&a[offset], &b[offset], length);
+			CHECK(std::fabs(sum - expected) <= 1e-5 * (magnitude + 1.0));
+		}
+	}
+}
+
+static void testThresholdAndScope()
+{
+	SemanticCache cache(10);
+	CHECK(cache.isEnabled());
+	cache.put(1, unitVector(8, 0), answer("x axis"));
+	cache.put(1, unitVector(8, 1), answer("y axis"));
+
+	// cos = 0.9 to the x axis (not normalized: the cache does it)
+	std::vector<float> nearX = unitVector(8, 0);
+	nearX[0] = 0.9f * 3.0f;
+	nearX[2] = std::sqrt(1.0f - 0.81f) * 3.0f;
+	CachedResponse cachedResponse;
+	float similarity = 0.0f;
+	CHECK(!cache.find(1, nearX, 0.95f, cachedResponse, similarity));
+	CHECK(cache.find(1, nearX, 0.85f, cachedResponse, similarity));
+	CHECK(cachedResponse.response == "x axis");
+	CHECK(std::fabs(similarity - 0.9f) < 1e-4f);
+
+	// The closest one wins
+	std::vector<float> between = { 0.6f, 0.8f, 0, 0, 0, 0, 0, 0 };
+	CHECK(cache.find(1, between, 0.5f, cachedResponse, similarity));
+	CHECK(cachedResponse.response == "y axis");
+
+	// Another scope (model, options...) is never compared; zero/other-size vectors are misses
+	CHECK(!cache.find(2, unitVector(8, 0), 0.5f, cachedResponse, similarity));
+	CHECK(!cache.find(1, std::vector<float>(8, 0.0f), 0.0f, cachedResponse, similarity));
+	CHECK(!cache.find(1, unitVector(4, 0), 0.0f, cachedResponse, similarity));
+	CHECK(cache.stats().hits == 2);
+}
+
+static void testRingAndDimension()
+{
+	SemanticCache cache(3);
+	CachedResponse cachedResponse;
+	float similarity;
+	for (size_t axis = 0; axis < 4; axis++)
+	{
+		cache.put(1, unitVector(8, axis), answer(std::to_string(axis)));
+	}
+	CHECK(cache.stats().entries == 3);
+	CHECK(!cache.find(1, unitVector(8, 0), 0.99f, cachedResponse, similarity)); // The oldest one was replaced
+	for (size_t axis = 1; axis < 4; axis++)
+	{
+		CHECK(cache.find(1, unitVector(8, axis), 0.99f, cachedResponse, similarity) && cachedResponse.response == std::to_string(axis));
+	}
+	cache.put(1, unitVector(8, 4), answer("4"));
+	CHECK(!cache.find(1, unitVector(8, 1), 0.99f, cachedResponse, similarity)); // Then the next oldest
+	CHECK(cache.find(1, unitVector(8, 4), 0.99f, cachedResponse, similarity) && cachedResponse.response == "4");
+	CHECK(cache.find(1, unitVector(8, 2), 0.99f, cachedResponse, similarity));
+
+	// Another embedding model (dimension): the cache starts over
+	cache.put(1, unitVector(16, 0), answer("16"));
+	SemanticCacheStats stats = cache.stats();
+	CHECK(stats.entries == 1 && stats.dimension == 16);
+	CHECK(!cache.find(1, unitVector(8, 2), 0.0f, cachedResponse, similarity));
+	CHECK(cache.find(1, unitVector(16, 0), 0.99f, cachedResponse, similarity) && cachedResponse.response == "16");
+
+	// Disabled: emptied, nothing stored
+	cache.setMaxEntries(0);
+	CHECK(!cache.isEnabled());
+	cache.put(1, unitVector(16, 1), answer("ignored"));
+	CHECK(cache.stats().entries == 0);
+	CHECK(!cache.find(1, unitVector(16, 1), 0.0f, cachedResponse, similarity));
+}
+
+int main()
+{
+	testDotProduct();
+	testThresholdAndScope();
+	testRingAndDimension();
+	return testResult();
+}
@@ -0,0 +1,208 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "StubServer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+StubServer::StubServer(Handler handler, size_t slots)
+	: _handler(handler)
+	, _slots(slots)
+{
+	int listenSocket = ::socket(AF_INET, SOCK_STREAM, 0);
+	if (listenSocket < 0)
+	{
+		return;
+	}
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = 0;
+	socklen_t addressLength = sizeof(address);
+	if (::bind(listenSocket, (sockaddr*)&address, sizeof(address)) != 0 || ::listen(listenSocket, 128) != 0
+		|| ::getsockname(listenSocket, (sockaddr*)&address, &addressLength) != 0)
+	{
+		::close(listenSocket);
+		return;
+	}
+	_port = ntohs(address.sin_port);
+	_listenSocket = listenSocket;
+	_acceptThread = std::thread(&StubServer::acceptConnections, this);
+}
+
+// Close the listening socket + every connection, then wait for their threads
+StubServer::~StubServer()
+{
+	if (_listenSocket < 0)
+	{
+		return;
+	}
+	_isStopping = true;
+	::shutdown(_listenSocket, SHUT_RDWR);
+	_acceptThread.join();
+	::close(_listenSocket);
+
+	std::vector<std::thread> threads;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (int socket : _sockets)
+		{
+			::shutdown(socket, SHUT_RDWR);
+		}
+		threads.swap(_threads);
+	}
+	_slotFreed.notify_all();
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	for (int socket : _sockets)
+	{
+		::close(socket); // Closed here only: a number reused by another connection would be shut down above
+	}
+}
+
+std::string StubServer::URL() const
+{
+	return "http://127.0.0.1:" + std::to_string(_port);
+}
+
+void StubServer::acceptConnections()
+{
+	while (!_isStopping)
+	{
+		int socket = ::accept(_listenSocket, nullptr, nullptr);
+		if (socket < 0)
+		{
+			return;
+		}
+		int isNoDelay = 1;
+		::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &isNoDelay, sizeof(isNoDelay));
+		std::lock_guard<std::mutex> lock(_mutex);
+		_sockets.push_back(socket);
+		_threads.emplace_back(&StubServer::serveConnection, this, socket);
+	}
+}
+
+bool StubServer::sendText(int socket, const std::string& text)
+{
+	size_t sent = 0;
+	while (sent < text.size())
+	{
+		ssize_t length = ::send(socket, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+		if (length <= 0)
+		{
+			return false;
+		}
+		sent += (size_t)length;
+	}
+	return true;
+}
+
+// Keep-alive: serve requests until the client (or `~StubServer()`) closes the connection; the socket is closed by `~StubServer()`
+void StubServer::serveConnection(int socket)
+{
+	std::string received;
+	char buffer[16384];
+	while (!_isStopping)
+	{
+		// Header + `Content-Length` body
+		size_t headerEnd;
+		while ((headerEnd = received.find("\r\n\r\n")) == std::string::npos)
+		{
+			ssize_t length = ::recv(socket, buffer, sizeof(buffer), 0);
+			if (length <= 0)
+			{
+				return;
+			}
+			received.append(buffer, (size_t)length);
+		}
+		std::string header = received.substr(0, headerEnd);
+		size_t bodyLength = 0;
+		size_t lengthField = header.find("Content-Length:");
+		if (lengthField != std::string::npos)
+		{
+			bodyLength = (size_t)std::strtoul(header.c_str() + lengthField + 15, nullptr, 10);
+		}
+		while (received.size() < headerEnd + 4 + bodyLength)
+		{
+			ssize_t length = ::recv(socket, buffer, sizeof(buffer), 0);
+			if (length <= 0)
+			{
+				return;
+			}
+			received.append(buffer, (size_t)length);
+		}
+		size_t pathBegin = header.find(' ') + 1;
+		std::string path = header.substr(pathBegin, header.find(' ', pathBegin) - pathBegin);
+		std::string body = received.substr(headerEnd + 4, bodyLength);
+		received.erase(0, headerEnd + 4 + bodyLength);
+		_requestCount++;
+
+		// Wait for a slot: the requests over `_slots` queue up like on an Ollama server
+		StubReply reply = _handler(path, body);
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_slotFreed.wait(lock, [this]() { return _slots == 0 || _busySlots < _slots || _isStopping; });
+			_busySlots++;
+			if (_busySlots > _maxConcurrent)
+			{
+				_maxConcurrent = _busySlots;
+			}
+		}
+		std::this_thread::sleep_for(reply.delay);
+
+		std::string status = "HTTP/1.1 " + std::to_string(reply.status) + ((reply.status < 400) ? " OK" : " Error") + "\r\nContent-Type: application/json\r\n";
+		bool isSent;
+		if (reply.parts.size() == 1)
+		{
+			isSent = sendText(socket, status + "Content-Length: " + std::to_string(reply.parts[0].size()) + "\r\n\r\n" + reply.parts[0]);
+		}
+		else
+		{
+			isSent = sendText(socket, status + "Transfer-Encoding: chunked\r\n\r\n");
+			for (size_t i = 0; i < reply.parts.size() && isSent; i++)
+			{
+				if (i > 0)
+				{
+					std::this_thread::sleep_for(reply.partDelay);
+				}
+				char size[32];
+				std::snprintf(size, sizeof(size), "%zx\r\n", reply.parts[i].size());
+				isSent = reply.parts[i].empty() || sendText(socket, size + reply.parts[i] + "\r\n");
+			}
+			isSent = isSent && sendText(socket, "0\r\n\r\n");
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_busySlots--;
+		}
+		_slotFreed.notify_one();
+		if (!isSent)
+		{
+			return;
+		}
+	}
+}
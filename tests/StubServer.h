@@ -0,0 +1,76 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#ifndef PLUGINNPPOPENAI_STUBSERVER_H
+#define PLUGINNPPOPENAI_STUBSERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Answer of `StubServer` to a POST request
+struct StubReply
+{
+	int status = 200;
+	std::vector<std::string> parts;       // One part: `Content-Length` body; more: chunked, sent one by one (NDJSON drip)
+	std::chrono::milliseconds delay{ 0 };     // Before the first part ("generation" time, holds a slot)
+	std::chrono::milliseconds partDelay{ 0 }; // Between two parts
+};
+
+// Local HTTP/1.1 server for the Linux tests (127.0.0.1, random port, keep-alive): every request is answered by `handler`.
+// `slots` > 0: max. requests served at once (like OLLAMA_NUM_PARALLEL), the others wait.
+class StubServer
+{
+public:
+	typedef std::function<StubReply(const std::string& path, const std::string& body)> Handler;
+
+	explicit StubServer(Handler handler, size_t slots = 0);
+	~StubServer();
+
+	bool isRunning() const { return _listenSocket >= 0; };
+	std::string URL() const; // Without trailing '/'
+	size_t requestCount() const { return _requestCount; };
+	size_t maxConcurrent() const { return _maxConcurrent; };
+
+protected:
+	void acceptConnections();
+	void serveConnection(int socket);
+	bool sendText(int socket, const std::string& text);
+
+	Handler _handler;
+	size_t _slots;
+	int _listenSocket = -1;
+	int _port = 0;
+	std::thread _acceptThread;
+	std::atomic<bool> _isStopping{ false };
+	std::atomic<size_t> _requestCount{ 0 };
+	std::atomic<size_t> _maxConcurrent{ 0 };
+
+	std::mutex _mutex; // Guards the members below
+	std::condition_variable _slotFreed;
+	size_t _busySlots = 0;
+	std::vector<int> _sockets;
+	std::vector<std::thread> _threads;
+};
+
+
+#endif // PLUGINNPPOPENAI_STUBSERVER_H
@@ -0,0 +1,54 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#ifndef PLUGINNPPOPENAI_TESTCHECK_H
+#define PLUGINNPPOPENAI_TESTCHECK_H
+
+#include <cstdio>
+
+// Minimal checks for the Linux test build: a failed `CHECK` is printed, `testResult()` is the exit code of the test
+inline int& testFailureCount()
+{
+	static int failureCount = 0;
+	return failureCount;
+}
+
+inline bool checkCondition(bool isOK, const char* condition, const char* file, int line)
+{
+	if (!isOK)
+	{
+		std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, condition);
+		testFailureCount()++;
+	}
+	return isOK;
+}
+
+inline int testResult()
+{
+	if (testFailureCount() > 0)
+	{
+		std::fprintf(stderr, "%d check(s) failed\n", testFailureCount());
+		return 1;
+	}
+	std::printf("OK\n");
+	return 0;
+}
+
+#define CHECK(condition) checkCondition((condition), #condition, __FILE__, __LINE__)
+
+
+#endif // PLUGINNPPOPENAI_TESTCHECK_H
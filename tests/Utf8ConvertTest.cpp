@@ -0,0 +1,329 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// Properties of the UTF-8 <-> UTF-16 conversion against a plain scalar reference (random + ill-formed input),
+// and a benchmark of both on ASCII and mixed text
+#include "Utf8Convert.h"
+#include "TestCheck.h"
+#include <chrono>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// Reference decoder: one code point at a time, U+FFFD per maximal invalid subpart (Unicode 3.9, "Best Practices for U+FFFD")
+static std::u32string referenceDecode(const std::string& text, bool& isValid)
+{
+	std::u32string codePoints;
+	isValid = true;
+	size_t i = 0;
+	while (i < text.size())
+	{
+		unsigned char lead = (unsigned char)text[i];
+		size_t trailCount = 0;
+		unsigned char low = 0x80, high = 0xBF; // Range of the first trail byte
+		char32_t codePoint = 0;
+		if (lead < 0x80)
+		{
+			codePoints += (char32_t)lead;
+			i++;
+			continue;
+		}
+		else if (lead >= 0xC2 && lead <= 0xDF)
+		{
+			trailCount = 1;
+			codePoint = lead & 0x1F;
+		}
+		else if (lead >= 0xE0 && lead <= 0xEF)
+		{
+			trailCount = 2;
+			codePoint = lead & 0x0F;
+			low = (lead == 0xE0) ? 0xA0 : 0x80;
+			high = (lead == 0xED) ? 0x9F : 0xBF;
+		}
+		else if (lead >= 0xF0 && lead <= 0xF4)
+		{
+			trailCount = 3;
+			codePoint = lead & 0x07;
+			low = (lead == 0xF0) ? 0x90 : 0x80;
+			high = (lead == 0xF4) ? 0x8F : 0xBF;
+		}
+		else
+		{
+			codePoints += (char32_t)0xFFFD;
+			isValid = false;
+			i++;
+			continue;
+		}
+
+		size_t next = i + 1;
+		bool isComplete = true;
+		for (size_t trail = 0; trail < trailCount; trail++, next++)
+		{
+			unsigned char c = (next < text.size()) ? (unsigned char)text[next] : 0;
+			if (next >= text.size() || c < low || c > high)
+			{
+				isComplete = false;
+				break;
+			}
+			codePoint = (codePoint << 6) | (c & 0x3F);
+			low = 0x80;
+			high = 0xBF;
+		}
+		if (!isComplete)
+		{
+			codePoints += (char32_t)0xFFFD;
+			isValid = false;
+		}
+		else
+		{
+			codePoints += codePoint;
+		}
+		i = next;
+	}
+	return codePoints;
+}
+
+static std::u16string referenceToUtf16(const std::u32string& codePoints)
+{
+	std::u16string text;
+	for (char32_t codePoint : codePoints)
+	{
+		if (codePoint >= 0x10000)
+		{
+			text += (char16_t)(0xD800 + ((codePoint - 0x10000) >> 10));
+			text += (char16_t)(0xDC00 + ((codePoint - 0x10000) & 0x3FF));
+		}
+		else
+		{
+			text += (char16_t)codePoint;
+		}
+	}
+	return text;
+}
+
+// Reference encoder: surrogate pairs are combined, unpaired surrogates become U+FFFD
+static std::string referenceToUtf8(const std::u16string& text)
+{
+	std::string bytes;
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		char32_t codePoint = text[i];
+		if (codePoint >= 0xD800 && codePoint <= 0xDBFF && i + 1 < text.size() && text[i + 1] >= 0xDC00 && text[i + 1] <= 0xDFFF)
+		{
+			codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (text[i + 1] - 0xDC00);
+			i++;
+		}
+		else if (codePoint >= 0xD800 && codePoint <= 0xDFFF)
+		{
+			codePoint = 0xFFFD;
+		}
+
+		if (codePoint < 0x80)
+		{
+			bytes += (char)codePoint;
+		}
+		else if (codePoint < 0x800)
+		{
+			bytes += (char)(0xC0 | (codePoint >> 6));
+			bytes += (char)(0x80 | (codePoint & 0x3F));
+		}
+		else if (codePoint < 0x10000)
+		{
+			bytes += (char)(0xE0 | (codePoint >> 12));
+			bytes += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+			bytes += (char)(0x80 | (codePoint & 0x3F));
+		}
+		else
+		{
+			bytes += (char)(0xF0 | (codePoint >> 18));
+			bytes += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+			bytes += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+			bytes += (char)(0x80 | (codePoint & 0x3F));
+		}
+	}
+	return bytes;
+}
+
+static std::u16string convertToUtf16(const std::string& text)
+{
+	std::u16string out(text.size(), u'\0');
+	out.resize(convertUtf8ToUtf16(text.data(), text.size(), &out[0]));
+	return out;
+}
+
+static std::string convertToUtf8(const std::u16string& text)
+{
+	std::string out(text.size() * 3, '\0');
+	out.resize(convertUtf16ToUtf8(text.data(), text.size(), &out[0]));
+	return out;
+}
+
+// Random text: ASCII runs (longer than a SIMD block), valid sequences of every length, and ill-formed bytes
+static std::string randomUtf8(std::mt19937& random, size_t length, bool isValidOnly)
+{
+	static const char* const samples[] = { "a", "\xC3\xA9", "\xE2\x82\xAC", "\xED\x9F\xBF", "\xEF\xBF\xBD", "\xF0\x9F\x98\x80", "\xF4\x8F\xBF\xBF" };
+	static const char* const invalid[] = { "\x80", "\xBF", "\xC0\xAF", "\xC1", "\xE0\x80\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\xF5", "\xFF",
+		"\xE2\x82", "\xF0\x9F\x98", "\xC3" };
+	std::string text;
+	while (text.size() < length)
+	{
+		switch (random() % 4)
+		{
+		case 0:
+			text.append(random() % 40, (char)('A' + random() % 26));
+			break;
+		case 1:
+		case 2:
+			text += samples[random() % (sizeof(samples) / sizeof(samples[0]))];
+			break;
+		default:
+			if (isValidOnly)
+			{
+				text += (char)(random() % 0x80);
+			}
+			else if (random() % 2)
+			{
+				text += invalid[random() % (sizeof(invalid) / sizeof(invalid[0]))];
+			}
+			else
+			{
+				text += (char)(random() % 0x100);
+			}
+			break;
+		}
+	}
+	return text;
+}
+
+static void testUtf8ToUtf16()
+{
+	std::mt19937 random(12345);
+	for (int i = 0; i < 20000; i++)
+	{
+		std::string text = randomUtf8(random, random() % 200, i % 3 == 0);
+		bool isValid;
+		std::u16string expected = referenceToUtf16(referenceDecode(text, isValid));
+		CHECK(convertToUtf16(text) == expected);
+		CHECK(isValidUtf8(text.data(), text.size()) == isValid);
+		if (i % 3 == 0)
+		{
+			CHECK(isValid);
+			CHECK(convertToUtf8(expected) == text); // Round trip
+		}
+	}
+}
+
+// A sequence cut at the end is carried over: both halves give the same units as the whole
+static void testUtf8ToUtf16Streaming()
+{
+	std::mt19937 random(777);
+	for (int i = 0; i < 5000; i++)
+	{
+		std::string text = randomUtf8(random, 1 + random() % 100, i % 2 == 0);
+		size_t split = random() % (text.size() + 1);
+		std::u16string out(text.size() + 4, u'\0');
+		size_t incompleteLength = 99;
+		size_t written = convertUtf8ToUtf16(text.data(), split, &out[0], &incompleteLength);
+		CHECK(incompleteLength <= 3 && incompleteLength <= split);
+		std::string rest = text.substr(split - incompleteLength);
+		written += convertUtf8ToUtf16(rest.data(), rest.size(), &out[written]);
+		out.resize(written);
+		CHECK(out == convertToUtf16(text));
+	}
+}
+
+static void testUtf16ToUtf8()
+{
+	std::mt19937 random(4242);
+	for (int i = 0; i < 20000; i++)
+	{
+		std::u16string text;
+		size_t length = random() % 200;
+		while (text.size() < length)
+		{
+			switch (random() % 5)
+			{
+			case 0:
+				text.append(random() % 40, (char16_t)('a' + random() % 26));
+				break;
+			case 1:
+				text += (char16_t)(0x80 + random() % 0x780);
+				break;
+			case 2:
+				text += (char16_t)(0xD800 + random() % 0x400); // Usually paired
+				text += (char16_t)(0xDC00 + random() % 0x400);
+				break;
+			case 3:
+				text += (char16_t)(0xD800 + random() % 0x800); // Unpaired
+				break;
+			default:
+				text += (char16_t)(random() % 0x10000);
+				break;
+			}
+		}
+		CHECK(convertToUtf8(text) == referenceToUtf8(text));
+	}
+}
+
+// MB/s of the library + the reference on 8 MB of ASCII (code) and of mixed text
+static void benchmark(const char* name, const std::string& text)
+{
+	const int rounds = 5;
+	size_t checksum = 0;
+	Clock::time_point startTime = Clock::now();
+	for (int round = 0; round < rounds; round++)
+	{
+		checksum += convertToUtf16(text).size();
+	}
+	double librarySeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+
+	startTime = Clock::now();
+	for (int round = 0; round < rounds; round++)
+	{
+		bool isValid;
+		checksum -= referenceToUtf16(referenceDecode(text, isValid)).size();
+	}
+	double referenceSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+	CHECK(checksum == 0);
+
+	double megabytes = (double)text.size() * rounds / 1e6;
+	std::printf("UTF-8 -> UTF-16, %s: %.0f MB/s (scalar reference: %.0f MB/s)\n", name, megabytes / librarySeconds, megabytes / referenceSeconds);
+}
+
+static void benchmarkConversions()
+{
+	std::string code;
+	while (code.size() < 8000000)
+	{
+		code += "for (size_t i = 0; i < length; i++) { sum += values[i]; } // Plain ASCII source\n";
+	}
+	benchmark("ASCII", code);
+
+	std::mt19937 random(99);
+	benchmark("mixed", randomUtf8(random, 8000000, true));
+}
+
+int main()
+{
+	testUtf8ToUtf16();
+	testUtf8ToUtf16Streaming();
+	testUtf16ToUtf8();
+	benchmarkConversions();
+	return testResult();
+}
@@ -0,0 +1,119 @@
+//this file is part of notepad++
+//Copyright (C)2022 Don HO <don.h@free.fr>
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either
+//version 2 of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// Fuzz: a UTF-8 stream split at random places (or byte by byte) decodes like the whole text at once
+#include "Utf8Convert.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// Random bytes with a bias towards (cut) multi-byte sequences
+static std::string randomBytes(std::mt19937& random, size_t length)
+{
+	static const char* const samples[] = { "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\xF4\x8F\xBF\xBF", "\xE2\x82", "\xF0\x9F", "\xED\xA0\x80",
+		"\xC0\x80", "\x80\x80", "\xF8" };
+	std::string text;
+	while (text.size() < length)
+	{
+		switch (random() % 4)
+		{
+		case 0:
+			text.append(random() % 24, 'x');
+			break;
+		case 1:
+		case 2:
+			text += samples[random() % (sizeof(samples) / sizeof(samples[0]))];
+			break;
+		default:
+			text += (char)(random() % 0x100);
+			break;
+		}
+	}
+	return text;
+}
+
+// The whole text at once, through the UTF-16 conversion: the same U+FFFD policy
+static std::string sanitized(const std::string& text)
+{
+	std::u16string wide(text.size(), u'\0');
+	wide.resize(convertUtf8ToUtf16(text.data(), text.size(), &wide[0]));
+	std::string out(wide.size() * 3, '\0');
+	out.resize(convertUtf16ToUtf8(wide.data(), wide.size(), &out[0]));
+	return out;
+}
+
+static std::string decodeSplit(const std::string& text, const std::vector<size_t>& splits)
+{
+	Utf8StreamDecoder decoder;
+	std::string out;
+	size_t start = 0;
+	for (size_t split : splits)
+	{
+		decoder.decode(text.data() + start, split - start, out);
+		CHECK(decoder.pendingLength() <= 3);
+		CHECK(isValidUtf8(out.data(), out.size())); // Only complete code points so far
+		start = split;
+	}
+	decoder.decode(text.data() + start, text.size() - start, out);
+	decoder.finish(out);
+	CHECK(decoder.pendingLength() == 0);
+	return out;
+}
+
+static void testRandomSplits()
+{
+	std::mt19937 random(2024);
+	for (int i = 0; i < 20000; i++)
+	{
+		std::string text = randomBytes(random, random() % 64);
+		std::vector<size_t> splits;
+		size_t splitCount = random() % 8;
+		for (size_t split = 0; split < splitCount; split++)
+		{
+			splits.push_back(text.empty() ? 0 : random() % (text.size() + 1));
+		}
+		std::sort(splits.begin(), splits.end()); // Empty fragments included
+
+		std::string expected = sanitized(text);
+		CHECK(decodeSplit(text, splits) == expected);
+		CHECK(decodeSplit(text, std::vector<size_t>()) == expected);
+	}
+}
+
+static void testByteByByte()
+{
+	std::mt19937 random(31);
+	for (int i = 0; i < 2000; i++)
+	{
+		std::string text = randomBytes(random, random() % 64);
+		std::vector<size_t> splits;
+		for (size_t split = 1; split < text.size(); split++)
+		{
+			splits.push_back(split);
+		}
+		CHECK(decodeSplit(text, splits) == sanitized(text));
+	}
+}
+
+int main()
+{
+	testRandomSplits();
+	testByteByByte();
+	return testResult();
+}